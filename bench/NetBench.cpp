@@ -0,0 +1,209 @@
+// Network benchmark: order and snapshot latency, delivery and bandwidth between a host and a client in
+// one process, over the loopback relay with simulated latency, jitter, loss, duplication and reordering.
+//
+//   NetBench [--seconds N] [--snapshot-bytes N] [--port N] ["latency=80,jitter=20,loss=0.02,seed=7" ...]
+//
+// Orders go client -> host reliably every 50 ms, snapshots host -> client unreliably at 20/s, the way
+// the game sends them. The fates of the datagrams are fixed by the seed, so runs differ only by timing.
+// Without conditions a fixed set of scenarios runs, from a clean link to a congested Wi-Fi.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "networking/NetworkManager.hpp"
+
+namespace
+{
+    constexpr double orderInterval = 0.05;
+    constexpr double snapshotInterval = 0.05;
+    constexpr double drainSeconds = 2.0; // after sending stops, for reliable resends still on their way
+
+#pragma pack(push, 1)
+    struct BenchMessage
+    {
+        uint32_t sequence;
+        double sentAt; // NetworkManager::clockNow(), both ends share the clock
+    };
+#pragma pack(pop)
+
+    struct Scenario
+    {
+        std::string name;
+        LinkConditions conditions;
+    };
+
+    struct Result
+    {
+        std::vector<double> orderLatencies; // ms
+        std::vector<double> snapshotLatencies;
+        uint32_t ordersSent = 0;
+        uint32_t snapshotsSent = 0;
+        double seconds = 0.0;
+        double rtt = 0.0;
+        LoopbackRelay::Stats relay;
+    };
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+    }
+
+    // one network tick of a peer, like Game::networkThreadMain
+    template <typename OnReceive>
+    void service(NetworkManager &network, OnReceive onReceive)
+    {
+        network.flush();
+        ENetPacket *packet = nullptr;
+        while (network.pollEvent(packet))
+        {
+            BenchMessage message{};
+            if (packet->dataLength >= sizeof(message))
+            {
+                std::memcpy(&message, packet->data, sizeof(message));
+                onReceive(message);
+            }
+            network.releasePacket(packet);
+        }
+    }
+
+    bool run(const Scenario &scenario, double seconds, size_t snapshotBytes, enet_uint16 port, Result &result)
+    {
+        NetworkManager host;
+        NetworkManager client;
+        if (!host.startServer(port) || !host.startLinkSimulation((enet_uint16)(port + 1), scenario.conditions, scenario.conditions) ||
+            !client.startClient("127.0.0.1", (enet_uint16)(port + 1)))
+            return false;
+
+        auto onOrder = [&](const BenchMessage &message)
+        { result.orderLatencies.push_back((NetworkManager::clockNow() - message.sentAt) * 1000.0); };
+        auto onSnapshot = [&](const BenchMessage &message)
+        { result.snapshotLatencies.push_back((NetworkManager::clockNow() - message.sentAt) * 1000.0); };
+
+        const double connectStart = NetworkManager::clockNow();
+        while (!(host.isConnected() && client.isConnected()))
+        {
+            if (NetworkManager::clockNow() - connectStart > 10.0)
+            {
+                std::fprintf(stderr, "%s: no connection through the relay\n", scenario.name.c_str());
+                return false;
+            }
+            service(host, onOrder);
+            service(client, onSnapshot);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::vector<uint8_t> snapshot(std::max(snapshotBytes, sizeof(BenchMessage)));
+        const double start = NetworkManager::clockNow();
+        double nextOrder = start;
+        double nextSnapshot = start;
+        for (double now = start; now - start < seconds + drainSeconds; now = NetworkManager::clockNow())
+        {
+            if (now - start < seconds && now >= nextOrder)
+            {
+                const BenchMessage order{++result.ordersSent, now};
+                client.send(order, 0, ENET_PACKET_FLAG_RELIABLE);
+                nextOrder += orderInterval;
+            }
+            if (now - start < seconds && now >= nextSnapshot)
+            {
+                const BenchMessage header{++result.snapshotsSent, now};
+                std::memcpy(snapshot.data(), &header, sizeof(header));
+                host.sendBytes(snapshot.data(), snapshot.size(), 1, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+                nextSnapshot += snapshotInterval;
+            }
+
+            service(host, onOrder);
+            service(client, onSnapshot);
+            std::this_thread::sleep_for(std::chrono::microseconds(250));
+        }
+
+        result.seconds = seconds;
+        result.rtt = client.getRtt();
+        result.relay = host.getLinkSimulationStats();
+        return true;
+    }
+
+    void report(const Scenario &scenario, const Result &result)
+    {
+        const size_t ordersLost = result.ordersSent - std::min<size_t>(result.ordersSent, result.orderLatencies.size());
+        std::printf("%-22s %7.1f %7.1f %7.1f %5zu %7.1f %7.1f %6.1f%% %9.0f %8.0f %7.1f\n", scenario.name.c_str(),
+                    percentile(result.orderLatencies, 0.5), percentile(result.orderLatencies, 0.99), percentile(result.orderLatencies, 1.0), ordersLost,
+                    percentile(result.snapshotLatencies, 0.5), percentile(result.snapshotLatencies, 0.99),
+                    result.snapshotsSent ? 100.0 * result.snapshotLatencies.size() / result.snapshotsSent : 0.0,
+                    result.relay.toClients.bytesDelivered / (result.seconds + drainSeconds), result.relay.toServer.bytesDelivered / (result.seconds + drainSeconds),
+                    result.rtt * 1000.0);
+    }
+
+    LinkConditions conditions(float latency, float jitter, float loss, float duplicate, float reorder)
+    {
+        LinkConditions c;
+        c.latencyMs = latency;
+        c.jitterMs = jitter;
+        c.loss = loss;
+        c.duplicate = duplicate;
+        c.reorder = reorder;
+        c.seed = 1234;
+        return c;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10.0;
+    size_t snapshotBytes = 1200;
+    enet_uint16 port = 24100;
+    std::vector<Scenario> scenarios;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--snapshot-bytes") == 0 && i + 1 < argc)
+            snapshotBytes = (size_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+            port = (enet_uint16)std::atoi(argv[++i]);
+        else
+        {
+            LinkConditions parsed;
+            if (!LinkConditions::parse(argv[i], parsed))
+            {
+                std::fprintf(stderr, "cannot parse link conditions \"%s\"\n", argv[i]);
+                return 1;
+            }
+            scenarios.push_back(Scenario{argv[i], parsed});
+        }
+    }
+
+    if (scenarios.empty())
+    {
+        scenarios.push_back(Scenario{"clean", conditions(0.f, 0.f, 0.f, 0.f, 0.f)});
+        scenarios.push_back(Scenario{"50 ms +-10", conditions(50.f, 10.f, 0.f, 0.f, 0.f)});
+        scenarios.push_back(Scenario{"50 ms, 2% loss", conditions(50.f, 10.f, 0.02f, 0.f, 0.f)});
+        scenarios.push_back(Scenario{"100 ms +-30, 5% loss", conditions(100.f, 30.f, 0.05f, 0.01f, 0.02f)});
+        scenarios.push_back(Scenario{"wi-fi: 30 ms +-40, 10%", conditions(30.f, 40.f, 0.1f, 0.02f, 0.05f)});
+    }
+
+    std::printf("%.0f s per scenario, orders every %.0f ms, %zu B snapshots every %.0f ms; latencies one way in ms\n\n", seconds, orderInterval * 1000.0,
+                snapshotBytes, snapshotInterval * 1000.0);
+    std::printf("%-22s %7s %7s %7s %5s %7s %7s %7s %9s %8s %7s\n", "link", "order50", "order99", "max", "lost", "snap50", "snap99", "recv", "down B/s", "up B/s", "rtt");
+
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        Result result;
+        // a fresh pair of ports per scenario, ENet's old connection may still be closing on the last ones
+        if (!run(scenarios[i], seconds, snapshotBytes, (enet_uint16)(port + 2 * i), result))
+            return 1;
+        report(scenarios[i], result);
+    }
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Snapshot codec benchmark: compression ratio and encode/decode throughput over recorded matches.
+//
+//   SnapshotCodecBench [--ack-lag N] replays/match_*.ctfr
+//
+// Replays are recorded in game with F7. Without files a synthetic battle is generated so the
+// numbers stay comparable between runs, but real replays are what decisions should be based on.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "networking/Replay.hpp"
+#include "networking/SnapshotCodec.hpp"
+
+namespace
+{
+    struct Frame
+    {
+        uint32_t tick;
+        std::vector<EntityState> states;
+    };
+
+    // naive encoding this codec replaces: id, kind, team, shooting, 6 floats per entity
+    constexpr size_t naiveEntityBytes = 4 + 3 + 6 * 4;
+
+    std::vector<Frame> loadReplay(const std::string &path)
+    {
+        std::vector<Frame> frames;
+        ReplayReader reader;
+        if (!reader.open(path))
+        {
+            std::fprintf(stderr, "cannot read replay %s\n", path.c_str());
+            return frames;
+        }
+
+        Frame frame;
+        while (reader.readFrame(frame.tick, frame.states))
+            frames.push_back(frame);
+        return frames;
+    }
+
+    // two armies walking at each other and trading damage, roughly what a long match looks like
+    std::vector<Frame> syntheticMatch(size_t unitsPerTeam, size_t frameCount)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+        std::vector<EntityState> states;
+        for (int team = 0; team < 2; team++)
+        {
+            states.push_back(EntityState{team << 24, UnitKind::Base, (uint8_t)team, false, false, {400.f, team == 0 ? 975.f : -175.f}, {400.f, team == 0 ? 975.f : -175.f}, 1000.f, 0.f});
+            for (size_t i = 0; i < unitsPerTeam; i++)
+            {
+                const UnitKind kind = (UnitKind)(rng() % 3);
+                const Vector2 pos{unit(rng) * 800.f, team == 0 ? 500.f + unit(rng) * 250.f : 50.f + unit(rng) * 250.f};
+                const Vector2 target{unit(rng) * 800.f, 400.f + (unit(rng) - 0.5f) * 200.f};
+                states.push_back(EntityState{(team << 24) | (int32_t)(i + 1), kind, (uint8_t)team, false, false, pos, target, kind == UnitKind::Artillery ? 200.f : 100.f, 0.f});
+            }
+        }
+
+        std::vector<Frame> frames;
+        const float dt = 1.f / 20.f;
+        for (size_t f = 0; f < frameCount; f++)
+        {
+            for (EntityState &state : states)
+            {
+                if (state.kind == UnitKind::Base)
+                    continue;
+
+                const Vector2 delta{state.desiredPosition.x - state.position.x, state.desiredPosition.y - state.position.y};
+                const float length = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+                state.shooting = length < 40.f && unit(rng) < 0.3f;
+                if (!state.shooting && length > 1.f)
+                {
+                    state.position.x += delta.x / length * 20.f * dt;
+                    state.position.y += delta.y / length * 20.f * dt;
+                }
+                state.cooldown = state.shooting ? 0.f : state.cooldown + dt;
+                if (unit(rng) < 0.02f)
+                    state.health = std::max(1.f, state.health - 25.f);
+                if (unit(rng) < 0.005f) // new order
+                    state.desiredPosition = {unit(rng) * 800.f, unit(rng) * 800.f};
+            }
+            frames.push_back(Frame{(uint32_t)(f * 3 + 3), states});
+        }
+        return frames;
+    }
+
+    void run(const char *name, std::vector<Frame> frames, size_t ackLag)
+    {
+        if (frames.empty())
+            return;
+
+        SnapshotCodec codec;
+        for (Frame &frame : frames)
+        {
+            std::sort(frame.states.begin(), frame.states.end(), [](const EntityState &a, const EntityState &b)
+                      { return a.id < b.id; });
+            codec.roundTrip(frame.states); // what the sender keeps as baselines
+        }
+
+        std::vector<uint8_t> buffer(1 << 20);
+        std::vector<EntityState> decoded;
+        const std::vector<EntityState> empty;
+
+        size_t entities = 0, naiveBytes = 0, fullBytes = 0, deltaBytes = 0, mismatches = 0;
+        double encodeSeconds = 0.0, decodeSeconds = 0.0;
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            const Frame &frame = frames[i];
+            const bool hasBaseline = i >= ackLag && ackLag > 0;
+            const std::vector<EntityState> &baseline = hasBaseline ? frames[i - ackLag].states : empty;
+            const uint32_t baselineTick = hasBaseline ? frames[i - ackLag].tick : 0;
+
+            entities += frame.states.size();
+            naiveBytes += frame.states.size() * naiveEntityBytes;
+            fullBytes += codec.encode(frame.tick, 0, empty, frame.states, buffer.data(), buffer.size());
+
+            const auto encodeStart = std::chrono::steady_clock::now();
+            const size_t size = codec.encode(frame.tick, baselineTick, baseline, frame.states, buffer.data(), buffer.size());
+            const auto encodeEnd = std::chrono::steady_clock::now();
+            codec.decode(buffer.data(), size, baseline, decoded);
+            const auto decodeEnd = std::chrono::steady_clock::now();
+
+            deltaBytes += size;
+            encodeSeconds += std::chrono::duration<double>(encodeEnd - encodeStart).count();
+            decodeSeconds += std::chrono::duration<double>(decodeEnd - encodeEnd).count();
+
+            if (decoded.size() != frame.states.size())
+                mismatches++;
+            else
+                for (size_t e = 0; e < decoded.size(); e++)
+                    if (decoded[e].id != frame.states[e].id || decoded[e].position != frame.states[e].position || decoded[e].health != frame.states[e].health ||
+                        decoded[e].cooldown != frame.states[e].cooldown || decoded[e].shooting != frame.states[e].shooting)
+                    {
+                        mismatches++;
+                        break;
+                    }
+        }
+
+        std::printf("%s\n", name);
+        std::printf("  frames %zu, entities/frame %.1f, ack lag %zu snapshots\n", frames.size(), (double)entities / frames.size(), ackLag);
+        std::printf("  naive %8.1f B/frame\n", (double)naiveBytes / frames.size());
+        std::printf("  full  %8.1f B/frame  ratio %5.2fx\n", (double)fullBytes / frames.size(), (double)naiveBytes / std::max<size_t>(fullBytes, 1));
+        std::printf("  delta %8.1f B/frame  ratio %5.2fx\n", (double)deltaBytes / frames.size(), (double)naiveBytes / std::max<size_t>(deltaBytes, 1));
+        std::printf("  encode %7.1f ns/entity (%.1f MB/s out), decode %7.1f ns/entity\n", encodeSeconds * 1e9 / entities,
+                    deltaBytes / std::max(encodeSeconds, 1e-9) / 1e6, decodeSeconds * 1e9 / entities);
+        std::printf("  decode mismatches %zu\n", mismatches);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t ackLag = 3; // ~150 ms round trip at 20 snapshots/s
+    std::vector<std::string> replays;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--ack-lag") == 0 && i + 1 < argc)
+            ackLag = (size_t)std::atoi(argv[++i]);
+        else
+            replays.push_back(argv[i]);
+    }
+
+    if (replays.empty())
+    {
+        run("synthetic, 2 x 50 units", syntheticMatch(50, 2000), ackLag);
+        run("synthetic, 2 x 250 units", syntheticMatch(250, 1000), ackLag);
+    }
+
+    for (const std::string &path : replays)
+        run(path.c_str(), loadReplay(path), ackLag);
+
+    return 0;
+}
@@ -6,10 +6,13 @@
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <ctime>
+#include <cstdlib>
 
 #include "utils/Math.hpp"
 #include "utils/ViewTransform.hpp"
 #include "utils/AudioManager.hpp"
+#include "utils/Hash.hpp"
 
 #ifdef _WIN32
 #include <minmax.h>
@@ -32,7 +35,7 @@ Game::Game()
     UnloadImage(icon);
 #endif
 
-    SetTargetFPS(120);
+    framePacer.init(targetFps, PacingMode::PowerSave);
 	SetExitKey(KEY_NULL); // disable ESC exit
     
     // Init audio
@@ -44,14 +47,22 @@ Game::Game()
     player2Button.init(FileSystem::getPath("res/utils/player2.png").c_str(), {280, 340}, 1.1f);
     restartButton.init(FileSystem::getPath("res/utils/restart.png").c_str(), {250, 500}, 1.1f);
 
-    backgroundGame = LoadTexture(FileSystem::getPath("res/utils/background.png").c_str());
+    backgroundGame.init(FileSystem::getPath("res/utils/background.png"), FileSystem::getPath("res/tiles"), "tile_cache", {worldWidth, worldHeight}, backgroundTileSize, backgroundBudgetBytes);
 	backgroundStart = LoadTexture(FileSystem::getPath("res/utils/startscreen.png").c_str());
 
     coinTexture = LoadTexture(FileSystem::getPath("res/utils/coin.png").c_str());
 
-    // Base, position later determined
-    entities.push_back(new Base({0, 0}, 0));
-    entities.push_back(new Base({0, 0}, 1));
+    camera.reset({(float)screenWidth, (float)screenHeight});
+    dynamicResolution.init(screenWidth, screenHeight, 1000.f / (float)targetFps);
+
+    // Base, position later determined; sequence 0 of each team is reserved for its base
+    for (int team = 0; team < 2; team++)
+    {
+        Entity *base = new Base({0, 0}, team);
+        base->setID((team & 0xFF) << 24);
+        entities.push_back(base);
+        trackEntity(base);
+    }
 
     // game variables
     lastReceived = "";
@@ -67,15 +78,18 @@ Game::Game()
 Game::~Game()
 {
     resetNetworkingState();
+    replay.close();
 
     for (auto &entity : entities)
     {
         delete entity;
     }
     entities.clear();
+    visibilityGrid.clear();
 
     // network already shut down by resetNetworkingState()
-    UnloadTexture(backgroundGame); // Unload button texture
+    backgroundGame.shutdown(); // stops the streaming thread, unloads tiles
+    dynamicResolution.shutdown();
     UnloadTexture(coinTexture);
 
     AudioManager::getInstance().Shutdown();
@@ -115,16 +129,36 @@ void Game::resetNetworkingState()
     clientConnected = false;
 
     // clean packet queues
+    // the network thread is stopped, so draining both ends from here is safe
+    ENetPacket *packet = nullptr;
+    while (incomingPackets.pop(packet))
+        network.releasePacket(packet);
+    if (pendingSnapshot)
     {
-        std::lock_guard<std::mutex> lock(incomingMutex);
-        std::queue<PacketData> empty;
-        incomingPackets.swap(empty);
-    }
-    {
-        std::lock_guard<std::mutex> lock(outgoingMutex);
-        std::queue<PacketData> empty;
-        outgoingPackets.swap(empty);
+        network.releasePacket(pendingSnapshot);
+        pendingSnapshot = nullptr;
     }
+    outgoingMessages.clear();
+    pendingCommands.header.count = 0;
+    scheduledCommands.clear();
+    commandBacklog.clear();
+    congestion.reset();
+
+    modeAnnounced = false;
+    linkUp = false;
+    resyncPending = false;
+    catchingUp = false;
+    resyncData.clear();
+    resyncOffset = 0;
+    spectatorsConfigured = false;
+    spectating = false;
+    lastSpectatorTick = 0;
+    spectatorStates.clear();
+    remoteCurrency = currency; // the host's view of the client's purse, rebuilt from here in the next replica session
+    lastAppliedSnapshot = 0;
+    resetSnapshotHistory();
+    snapshotInterpolator.reset();
+    resetLockstep();
 }
 
 void Game::run()
@@ -132,16 +166,21 @@ void Game::run()
     // Main game loop
     while (!WindowShouldClose() && running) // Detect window close button or ESC key
     {
-        dt = GetFrameTime();             // delta time that passes between the loop cycles
-        mousePoint = GetMousePosition(); // current mouse pos
-        bool mousePressed = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+        framePacer.beginFrame(); // low latency mode sleeps here and samples input late
+        input = framePacer.takeInput();
 
-        AudioManager::getInstance().Update();
+        dt = GetFrameTime();      // delta time that passes between the loop cycles
+        mousePoint = input.mousePos; // current mouse pos
+        bool mousePressed = input.mouseLeftPressed;
+
+        handleDebugKeys();
+        if (netStatsLog.isOpen())
+            netStatsLog.write(network.getStats()); // only new reports are written
 
         if (beginGame) // start of the game, starting screen
         {
-            player1Button.update(mousePoint);
-            player2Button.update(mousePoint);
+            player1Button.update(input);
+            player2Button.update(input);
             if (player1Button.isPressed())
             {
                 AudioManager::getInstance().Play(SoundId::ButtonClick);
@@ -162,7 +201,7 @@ void Game::run()
         else if (endGame)
         {
             // check for button press to restart
-            restartButton.update(mousePoint);
+            restartButton.update(input);
             if (restartButton.isPressed())
             {
                 AudioManager::getInstance().Play(SoundId::ButtonClick);
@@ -177,8 +216,21 @@ void Game::run()
         }
         else if (clientConnected) // main game loop
         {
+            if (linkUp && network.getConnectionCount() != linkConnection)
+                onLinkDown(); // lost and back within a frame
+            if (!linkUp)
+                onLinkUp();
+
+            camera.update(dt, input);
+            dynamicResolution.update(framePacer.getWorkTime()); // not dt: that includes pacing sleeps and the vsync wait
+
             // get all packets sent by server/client
             getPacketsIn();
+            if (runAsServer)
+            {
+                announceMode();
+                streamResync();
+            }
 
             // update currency
             static float incomeTimer = 0.f;
@@ -186,6 +238,8 @@ void Game::run()
             if (incomeTimer >= 2.f)
             {
                 currency += income;
+                if (runAsServer && netMode == NetMode::Authoritative)
+                    remoteCurrency += income;
                 incomeTimer = 0.f;
             }
 
@@ -202,9 +256,9 @@ void Game::run()
             }
 
             // handle mouse input for rearranging troops
-            if (mousePressed)
+            if (mousePressed && acceptsInput() && (!selectedTroop || canIssueCommand()))
             {
-                Vector2 worldPos = ViewToWorld(mousePoint, !runAsServer);
+                Vector2 worldPos = camera.screenToWorld(mousePoint, !runAsServer);
 
                 if (!selectedTroop)
                 {
@@ -218,92 +272,69 @@ void Game::run()
                 }
                 else
                 {
-                    PacketData pkt{};
-                    pkt.type = TroopType::Change;
-                    pkt.entityId = selectedEntity->getID();
-                    pkt.desiredPos[0] = worldPos.x;
-                    pkt.desiredPos[1] = worldPos.y;
-                    selectedEntity->setDesiredPosition(worldPos);
-                    sendPacket(pkt);
-
-                    drawPos.push_back(DrawMarker{worldPos, 2.0f});
+                    if (appliesInputLocally()) // lockstep: applied when its tick comes, on both peers
+                        selectedEntity->setDesiredPosition(worldPos);
+                    events.push_back(GameEvent{GameEventType::OrderIssued, selectedEntity->getKind(), selectedEntity->getTeam(), selectedEntity->getID(), worldPos, true});
 
                     selectedTroop = false;
                     selectedEntity = nullptr;
                 }
             }
 
-            PacketData pkt{};
-            pkt.type = TroopType::None;
-            Vector2 pos = ViewToWorld(mousePoint, !runAsServer);
+            Vector2 pos = camera.screenToWorld(mousePoint, !runAsServer);
+            UnitKind spawnKind = UnitKind::Base; // Base = nothing to spawn
 
             // Input handling
             if (IsKeyDown(KEY_ONE)) // Infantry
-            {
-                if (currency < infantryCost)
-                    goto _continue;
-
-                currency -= infantryCost;
-                const int team = runAsServer ? 0 : 1;
-                const Vector2 spawnPos = runAsServer ? startPosPlayer1 : startPosPlayer2;
-                Entity *ent = new Infantry(spawnPos, team, pos);
-                const int id = allocateEntityId(team);
-                ent->setID(id);
-                entities.push_back(ent);
-                pkt.entityId = id;
-
-                pkt.type = TroopType::Infantry;
-            }
+                spawnKind = UnitKind::Infantry;
             else if (IsKeyDown(KEY_TWO)) // cavalry
-            {
-                if (currency < cavalryCost)
-                    goto _continue;
-                currency -= cavalryCost;
-                const int team = runAsServer ? 0 : 1;
-                const Vector2 spawnPos = runAsServer ? startPosPlayer1 : startPosPlayer2;
-                Entity *ent = new Cavalry(spawnPos, team, pos);
-                const int id = allocateEntityId(team);
-                ent->setID(id);
-                entities.push_back(ent);
-                pkt.entityId = id;
-
-                pkt.type = TroopType::Cavallry;
-            }
+                spawnKind = UnitKind::Cavalry;
             else if (IsKeyDown(KEY_THREE)) // artillery
+                spawnKind = UnitKind::Artillery;
+
+            if (spawnKind != UnitKind::Base && acceptsInput() && canIssueCommand())
             {
-                if (currency < artilleryCost)
+                if (currency < unitCost(spawnKind))
                     goto _continue;
-                currency -= artilleryCost;
+                currency -= unitCost(spawnKind);
+
                 const int team = runAsServer ? 0 : 1;
                 const Vector2 spawnPos = runAsServer ? startPosPlayer1 : startPosPlayer2;
-                Entity *ent = new Artillery(spawnPos, team, pos);
                 const int id = allocateEntityId(team);
-                ent->setID(id);
-                entities.push_back(ent);
-                pkt.entityId = id;
-
-                pkt.type = TroopType::Artillery;
-            }
 
-            if (pkt.type != TroopType::None)
-            {
-                drawPos.push_back(DrawMarker{pos, 2.0f});
-                pkt.desiredPos[0] = pos.x;
-                pkt.desiredPos[1] = pos.y;
-                sendPacket(pkt);
+                // a replica only requests the spawn, the unit shows up with the next snapshot;
+                // in lockstep it is created when the command's tick runs
+                if (appliesInputLocally())
+                {
+                    Entity *spawned = createEntity(spawnKind, team, spawnPos, pos);
+                    spawned->setID(id);
+                    entities.push_back(spawned);
+                    trackEntity(spawned);
+                }
+                events.push_back(GameEvent{GameEventType::Spawn, spawnKind, team, id, pos, true});
             }
 
         _continue:
-            update(); // update game state; entities
+            if (runAsServer ? modeAnnounced : configReceived && !resyncPending) // the mode reaches the client before any tick's commands
+                stepSimulation(); // update game state; entities
+            if (isReplica() && interpolateRender)
+                interpolateReplica();
+            processEvents();
         }
         else
         {
+            if (linkUp)
+                onLinkDown();
+
             // waiting for connection screen
             // start networking again -> try to connect again
 			if (!networkThreadRunning)
 				startNetworking(); // reset networking state gets called inside
         }
 
+        // trigger the sounds requested this frame, coalesced per sound
+        AudioManager::getInstance().Update();
+
         // Draw
         BeginDrawing();
         ClearBackground(WHITE);
@@ -324,35 +355,47 @@ void Game::run()
         }
         else if (clientConnected)
         {
-            DrawTexture(backgroundGame, 0, 0, WHITE);
+            const Rectangle visible = camera.visibleWorldBounds(!runAsServer);
 
-            // draw currency
-            Vector2 currencyPos = {780.f, 40.f};
-            DrawTextureEx(coinTexture, {currencyPos.x - 110.f, currencyPos.y - 20.f}, 0.f, 0.1f, WHITE);
-            DrawText(std::to_string(currency).c_str(), currencyPos.x - 90.f, currencyPos.y, 25, WHITE);
+            const Rectangle visibleView = camera.visibleViewBounds();
+            backgroundGame.update(visibleView);
 
-            // draw desired position
-            for (auto &marker : drawPos)
+            backgroundGame.draw(renderQueue, visibleView);
+
+            // interpolation factor between the previous and the current simulation tick
+            const float alpha = interpolateRender ? simAccumulator / getSimStep() : 1.f;
+
+			// draw visible entities, off-screen ones skip all draw work (incl. health bars)
+            cullEntities();
+            for (Entity *entity : visibleEntities)
             {
-                Vector2 viewPos = WorldToView(marker.pos, !runAsServer);
-                DrawCircle(viewPos.x, viewPos.y, 7.f, YELLOW);
+                entity->draw(renderQueue, !runAsServer, alpha);
             }
 
-			// draw all entities
-            for (auto &entity : entities)
-            {
-                entity->draw(!runAsServer);
+            // scene at scaled resolution, upscaled to the window
+            dynamicResolution.beginScene();
+            camera.begin(dynamicResolution.getScale());
+            renderQueue.flush();
+            camera.end();
+            dynamicResolution.endScene();
+            dynamicResolution.present();
 
-                continue;
+            // draw desired position, markers are UI and stay at native resolution
+            camera.begin();
+            for (auto &marker : drawPos)
+            {
+                if (!CheckCollisionPointRec(marker.pos, visible))
+                    continue;
 
-                auto pos = entity->getPosition();
-                pos = WorldToView(pos, !runAsServer);
-                DrawCircleLines(
-                    pos.x,
-                    pos.y,
-                    entity->getCircleCollider().radius,
-                    BLACK);
+                Vector2 viewPos = WorldToView(marker.pos, !runAsServer);
+                DrawCircle(viewPos.x, viewPos.y, 7.f, YELLOW);
             }
+            camera.end();
+
+            // draw currency
+            Vector2 currencyPos = {780.f, 40.f};
+            DrawTextureEx(coinTexture, {currencyPos.x - 110.f, currencyPos.y - 20.f}, 0.f, 0.1f, WHITE);
+            DrawText(std::to_string(currency).c_str(), currencyPos.x - 90.f, currencyPos.y, 25, WHITE);
         }
         else
         {
@@ -361,11 +404,453 @@ void Game::run()
             DrawText(runAsServer ? "You are Player 1 (Blue)" : "You are Player 2 (Red)", 10, 10, 20, BLACK);
         }
 
+        if (showDebugOverlay)
+            drawDebugOverlay();
+        if (showNetworkOverlay)
+            drawNetworkOverlay();
+
+        framePacer.beginPresent();
         EndDrawing();
+        framePacer.endFrame(); // power save mode sleeps here
+    }
+}
+
+void Game::stepSimulation()
+{
+    const float simStep = getSimStep();
+
+    simAccumulator += dt * tickClockCorrection(simStep);
+    const int maxSteps = catchingUp ? maxCatchUpStepsPerFrame : maxSimStepsPerFrame;
+    if (simAccumulator > simStep * maxSteps) // drop time after long stalls (window drag, breakpoints)
+        simAccumulator = simStep * maxSteps;
+
+    const double start = GetTime();
+
+    simTicksThisFrame = 0;
+    rollbackDepthThisFrame = 0;
+    resimMsThisFrame = 0.f;
+    if (netMode == NetMode::Rollback)
+        rollBack(simStep);
+
+    while (simAccumulator >= simStep && !endGame)
+    {
+        if (exchangesTickFrames())
+        {
+            const bool ready = netMode == NetMode::Lockstep ? lockstepFrameReady(simTick) : simTick - confirmedTick < maxPredictionTicks;
+            if (!ready)
+            {
+                lockstepStalls++;
+                break; // keeps the accumulated time, catches up once the peer's frame is in
+            }
+            if (!sendLockstepFrame(simTick + commandDelayTicks()))
+            {
+                lockstepStalls++;
+                break; // no tick without our frame on its way, retried once the network thread made room
+            }
+        }
+
+        // keep the last tick's state for render interpolation
+        for (Entity *entity : entities)
+            entity->storePreviousPosition();
+
+        if (!exchangesTickFrames())
+            runScheduledCommands(simTick); // the peer's commands at the tick they were issued for
+
+        if (netMode == NetMode::Lockstep)
+        {
+            runLockstepCommands(simTick);
+            update(simStep);
+            recordTickHash(simTick, hashSimulationState());
+        }
+        else if (netMode == NetMode::Rollback)
+        {
+            simulateRollbackTick(simTick, simStep);
+        }
+        else if (!isReplica())
+        {
+            update(simStep);
+        }
+        else if (pendingSnapshot) // the host ran combat, take over its result
+        {
+            applySnapshot(pendingSnapshot);
+            network.releasePacket(pendingSnapshot);
+            pendingSnapshot = nullptr;
+        }
+
+        simAccumulator -= simStep;
+        simTick++;
+        simTicksThisFrame++;
+
+        if (netMode == NetMode::Rollback)
+            confirmRollbackTicks();
+    }
+
+    // our tick clock for the peer's clock sync: when tick 0 would have been
+    network.setLocalTickClock(NetworkManager::clockNow() - (simTick + simAccumulator / simStep) / simRates[simRateIndex], (float)simRates[simRateIndex]);
+
+    if (runAsServer && netMode == NetMode::Authoritative)
+    {
+        // back off when the link to the client congests, recover slowly
+        congestion.update(network.getLinkStats(), NetworkManager::clockNow());
+        replicationBytesPerSecond = congestion.getBytesPerSecond();
+        snapshotRate = congestion.getSendRate();
+
+        const int ticks = simRates[simRateIndex] / snapshotRate;
+        const uint32_t ticksPerSnapshot = ticks > 1 ? (uint32_t)ticks : 1;
+        if (simTick - lastSnapshotTick >= ticksPerSnapshot)
+            queueSnapshot();
+    }
+
+    // spectators watch the host's world whatever the mode
+    if (runAsServer && network.getSpectatorCount() > 0 && simTick - lastSpectatorTick >= (uint32_t)(simRates[simRateIndex] / spectatorSnapshotRate))
+        queueSpectatorSnapshot();
+
+    const uint32_t ticksPerReplayFrame = (uint32_t)(simRates[simRateIndex] / replayFrameRate);
+    if (replay.isOpen() && simTicksThisFrame > 0 && simTick % ticksPerReplayFrame < (uint32_t)simTicksThisFrame)
+    {
+        captureStates(replayScratch);
+        replay.writeFrame(simTick, replayScratch);
+    }
+
+    // smoothed cpu time spent in the simulation this frame
+    const float elapsedMs = (float)((GetTime() - start) * 1000.0);
+    simCpuMs += (elapsedMs - simCpuMs) * 0.05f;
+}
+
+void Game::cullEntities()
+{
+    visibleEntities.clear();
+    visibilityGrid.query(camera.visibleWorldBounds(!runAsServer), [this](Entity *entity)
+                         { visibleEntities.push_back(entity); });
+
+    // the same draw order every frame, whatever order the cells hand them out in
+    std::sort(visibleEntities.begin(), visibleEntities.end(), [](const Entity *a, const Entity *b)
+              { return a->getID() < b->getID(); });
+    entitiesDrawn = visibleEntities.size();
+}
+
+void Game::trackEntity(Entity *entity)
+{
+    if (!entity)
+        return;
+
+    // everything it is drawn at between the previous and the current tick
+    const Vector2 previous = entity->getRenderPosition(0.f);
+    const Vector2 current = entity->getPosition();
+    const float extent = entity->getCircleCollider().radius + entityDrawMargin;
+    const float left = (previous.x < current.x ? previous.x : current.x) - extent;
+    const float top = (previous.y < current.y ? previous.y : current.y) - extent;
+    const float right = (previous.x > current.x ? previous.x : current.x) + extent;
+    const float bottom = (previous.y > current.y ? previous.y : current.y) + extent;
+    visibilityGrid.update(entity, {left, top, right - left, bottom - top});
+}
+
+void Game::deleteEntity(Entity *entity)
+{
+    if (!entity)
+        return;
+    // selection must not outlive the unit
+    if (entity == selectedEntity)
+    {
+        selectedEntity = nullptr;
+        selectedTroop = false;
+    }
+    visibilityGrid.remove(entity);
+    delete entity;
+}
+
+void Game::processEvents()
+{
+    processAudioEvents();
+    processUiEvents();
+    processNetworkEvents();
+
+    events.clear();
+}
+
+void Game::processAudioEvents()
+{
+    AudioManager &audio = AudioManager::getInstance();
+
+    for (const GameEvent &event : events)
+    {
+        switch (event.type)
+        {
+        case GameEventType::AttackFired:
+            if (event.kind == UnitKind::Artillery)
+                audio.Play(SoundId::ArtilleryAttack, 0.8f);
+            else
+                audio.Play(SoundId::NormalAttack, 0.1f);
+            break;
+        case GameEventType::UnitMarching:
+            audio.Play(SoundId::March, 0.1f);
+            break;
+        case GameEventType::BaseDestroyed:
+            audio.PlayMusic();
+
+            if ((event.team == 0 && runAsServer) || (event.team == 1 && !runAsServer))
+                audio.Play(SoundId::Defeat);
+            else
+                audio.Play(SoundId::Victory);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Game::processUiEvents()
+{
+    for (const GameEvent &event : events)
+    {
+        switch (event.type)
+        {
+        case GameEventType::Spawn:
+        case GameEventType::OrderIssued:
+            if (event.local)
+                drawPos.push_back(DrawMarker{event.pos, 2.0f});
+            break;
+        case GameEventType::BaseDestroyed:
+            endText = std::string((event.team == 0) ? "The Flag goes to Player 2!" : "The Flag goes to Player 1!");
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Game::processNetworkEvents()
+{
+    for (const GameEvent &event : events)
+    {
+        if (!event.local)
+            continue;
+
+        PacketData pkt{};
+        pkt.type = TroopType::None;
+        pkt.entityId = event.entityId;
+        pkt.desiredPos[0] = event.pos.x;
+        pkt.desiredPos[1] = event.pos.y;
+
+        if (event.type == GameEventType::OrderIssued)
+        {
+            pkt.type = TroopType::Change;
+        }
+        else if (event.type == GameEventType::Spawn)
+        {
+            switch (event.kind)
+            {
+            case UnitKind::Infantry:
+                pkt.type = TroopType::Infantry;
+                break;
+            case UnitKind::Cavalry:
+                pkt.type = TroopType::Cavallry;
+                break;
+            case UnitKind::Artillery:
+                pkt.type = TroopType::Artillery;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (pkt.type != TroopType::None)
+            sendPacket(pkt);
+    }
+
+    // everything issued this frame leaves as one frame
+    flushCommands();
+}
+
+void Game::handleDebugKeys()
+{
+    if (input.keyPressed(KEY_F1))
+        showDebugOverlay = !showDebugOverlay;
+
+    if (input.keyPressed(KEY_F2) && !exchangesTickFrames()) // cycle simulation tick rate (fixed in lockstep and rollback)
+    {
+        simRateIndex = (simRateIndex + 1) % simRates.size();
+        simAccumulator = 0.f;
+        modeAnnounced = false; // replicas map snapshot ticks to time with it
+    }
+
+    if (input.keyPressed(KEY_F3))
+        interpolateRender = !interpolateRender;
+
+    if (input.keyPressed(KEY_F4)) // auto / fixed render scale
+    {
+        renderScaleIndex = (renderScaleIndex + 1) % fixedRenderScales.size();
+        if (fixedRenderScales[renderScaleIndex] <= 0.f)
+            dynamicResolution.setAuto();
+        else
+            dynamicResolution.setFixedScale(fixedRenderScales[renderScaleIndex]);
+    }
+
+    if (input.keyPressed(KEY_F5)) // low latency -> power save -> vsync
+    {
+        switch (framePacer.getMode())
+        {
+        case PacingMode::LowLatency:
+            framePacer.setMode(PacingMode::PowerSave);
+            break;
+        case PacingMode::PowerSave:
+            framePacer.setMode(PacingMode::VSync);
+            break;
+        case PacingMode::VSync:
+            framePacer.setMode(PacingMode::LowLatency);
+            break;
+        }
+    }
+
+    if (input.keyPressed(KEY_F6) && runAsServer) // the host picks how peers stay in sync
+    {
+        // lockstep and rollback need both simulations to start from the same state, so they can
+        // only be entered or left before the client joins
+        switch (netMode)
+        {
+        case NetMode::Independent:
+            netMode = NetMode::Authoritative;
+            break;
+        case NetMode::Authoritative:
+            netMode = clientConnected ? NetMode::Independent : NetMode::Lockstep;
+            break;
+        case NetMode::Lockstep:
+            if (!clientConnected)
+                netMode = NetMode::Rollback;
+            break;
+        case NetMode::Rollback:
+            if (!clientConnected)
+                netMode = NetMode::Independent;
+            break;
+        }
+        modeAnnounced = false;
+        remoteCurrency = currency; // whatever was tracked for the client belongs to the previous mode
+    }
+
+    if (input.keyPressed(KEY_F7)) // record the match for the snapshot codec benchmark
+        toggleReplayRecording();
+
+    if (input.keyPressed(KEY_F8))
+        showNetworkOverlay = !showNetworkOverlay;
+
+    if (input.keyPressed(KEY_F9)) // network statistics to a CSV file, once per second
+        toggleNetworkStatsLog();
+}
+
+void Game::drawDebugOverlay()
+{
+    int y = 10;
+    const int fontSize = 16;
+    const int lineHeight = 18;
+
+    DrawRectangle(5, 5, 300, 19 * lineHeight + 10, Color{0, 0, 0, 160});
+
+    DrawText(TextFormat("FPS %d (%.2f ms)", GetFPS(), dt * 1000.f), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Sim %d Hz [F2] | %d ticks this frame", simRates[simRateIndex], simTicksThisFrame), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Sim cpu %.3f ms/frame", simCpuMs), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Interpolation %s [F3]", interpolateRender ? "on" : "off"), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Entities drawn %zu / %zu | zoom %.2f", entitiesDrawn, entities.size(), camera.getZoom()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Tiles %zu (%zu KB) | %zu streaming", backgroundGame.getResidentTiles(), backgroundGame.getResidentBytes() / 1024, backgroundGame.getPendingTiles()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Draw commands %zu | batches %d", renderQueue.getCommandsLastFlush(), renderQueue.getBatchesLastFlush()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Render scale %d%% %s [F4]", (int)(dynamicResolution.getScale() * 100.f + 0.5f), dynamicResolution.getMode() == DynamicResolution::Mode::Auto ? "auto" : "fixed"), 10, y, fontSize, WHITE);
+    y += lineHeight;
+
+    const FramePacer::Report &pacing = framePacer.getReport();
+    DrawText(TextFormat("Pacing %s [F5]", FramePacer::modeName(framePacer.getMode())), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Frame p50 %.2f p99 %.2f p99.9 %.2f ms", pacing.frameP50, pacing.frameP99, pacing.frameP999), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Input->present p50 %.2f p99 %.2f ms (%zu)", pacing.latencyP50, pacing.latencyP99, pacing.latencySamples), 10, y, fontSize, WHITE);
+    y += lineHeight;
+
+    const AudioManager &audio = AudioManager::getInstance();
+    DrawText(TextFormat("Audio requests %d -> triggers %d | voices %d | dropped %zu", audio.getRequestsLastUpdate(), audio.getTriggersLastUpdate(), audio.getVoicesPlaying(), audio.getDroppedCommands()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Net queues in %zu out %zu | overflows out %zu | stalls in %zu recv %zu | pool empty %zu", incomingPackets.size(), outgoingMessages.size(), outgoingMessages.getOverflows(), incomingStalls.load(std::memory_order_relaxed), network.getReceiveStalls(), network.getSendPoolExhausted()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Net mode %s [F6] | snapshot tick %u (%zu B)%s", spectating ? "spectator" : netMode == NetMode::Rollback ? "rollback" : netMode == NetMode::Lockstep ? "lockstep" : netMode == NetMode::Authoritative ? (runAsServer ? "authoritative host" : "replica") : "independent", runAsServer ? lastSnapshotTick : lastAppliedSnapshot, lastSnapshotBytes, replay.isOpen() ? " | REC [F7]" : ""), 10, y, fontSize, WHITE);
+    if (runAsServer && network.getSpectatorCount() > 0)
+        DrawText(TextFormat("| spectators %zu, stream tick %u (%zu B)", network.getSpectatorCount(), lastSpectatorTick, lastSpectatorBytes), 520, y, fontSize, WHITE);
+    y += lineHeight;
+    if (exchangesTickFrames())
+    {
+        if (desynced)
+            DrawText(TextFormat("Lockstep DESYNC at tick %u", desyncTick), 10, y, fontSize, RED);
+        else
+            DrawText(TextFormat("Lockstep delay %u ticks | stalls %zu | verified tick %u", commandDelayTicks(), lockstepStalls, lastVerifiedTick), 10, y, fontSize, WHITE);
+    }
+    y += lineHeight;
+    if (netMode == NetMode::Rollback)
+        DrawText(TextFormat("Rollback depth %u (max %u) | resim %.2f ms (max %.2f) | rollbacks %zu | predicting %u", rollbackDepthThisFrame, maxRollbackDepth, resimMsThisFrame, maxResimMs, rollbackCount, simTick - confirmedTick), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    std::string peerRates;
+    for (size_t i = 0; i < NetworkManager::maxPeers; i++)
+        if (const size_t rate = network.getPeerSendRate(i))
+            peerRates += TextFormat(" | peer %zu %zu B/s", i, rate);
+    if (runAsServer && netMode == NetMode::Authoritative)
+        DrawText(TextFormat("Replication %zu B/s at %d/s%s | snapshot loss %.1f%% | sent %zu deferred %zu%s", replicationBytesPerSecond, snapshotRate, congestion.isCongested() ? " CONGESTED" : "", congestion.getSnapshotLoss() * 100.f, replicationScheduler.getSentLastSnapshot(), replicationScheduler.getDeferredLastSnapshot(), peerRates.c_str()), 10, y, fontSize, WHITE);
+    else
+        DrawText(TextFormat("Sending%s", peerRates.empty() ? " -" : peerRates.c_str()), 10, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Clock rtt %.1f ms | jitter %.1f ms | offset %.1f ms | host tick %+.1f", network.getRtt() * 1000.0, network.getRttJitter() * 1000.0, network.getClockOffset() * 1000.0, tickClockError), 10, y, fontSize, WHITE);
+    if (resyncPending || catchingUp)
+        DrawText(TextFormat("| rejoining: %s", resyncPending ? TextFormat("state %zu/%zu B", resyncOffset, resyncData.size()) : "catching up"), 520, y, fontSize, YELLOW);
+    else if (lastResyncBytes > 0 && runAsServer) // only the client knows when it resumed
+        DrawText(TextFormat("| resync %zu B sent", lastResyncBytes), 520, y, fontSize, WHITE);
+    else if (lastResyncBytes > 0)
+        DrawText(TextFormat("| resync %zu B, resumed in %.0f ms", lastResyncBytes, lastResumeMs), 520, y, fontSize, WHITE);
+    y += lineHeight;
+    if (isReplica())
+        DrawText(TextFormat("Interp delay %.0f ms | jitter %.1f ms | extrapolated %zu of %zu [F3]", snapshotInterpolator.getDelay() * 1000.0, snapshotInterpolator.getJitter() * 1000.0, snapshotInterpolator.getExtrapolatedLastFrame(), snapshotInterpolator.getTrackedEntities()), 10, y, fontSize, WHITE);
+}
+
+void Game::drawNetworkOverlay()
+{
+    const int fontSize = 16;
+    const int lineHeight = 18;
+    const int lines = 8;
+    const int x = 10;
+    int y = screenHeight - lines * lineHeight - 10;
+
+    DrawRectangle(5, y - 5, 470, lines * lineHeight + 10, Color{0, 0, 0, 160});
+
+    const NetworkStats::Report stats = network.getStats();
+    DrawText(TextFormat("Network [F8] | %s | peers %u | CSV %s [F9]", runAsServer ? "host" : "client", stats.peers, netStatsLog.isOpen() ? netStatsLog.getPath().c_str() : "off"), x, y, fontSize, WHITE);
+    y += lineHeight;
+    if (stats.sequence == 0)
+    {
+        DrawText("no report yet", x, y, fontSize, GRAY);
+        return;
+    }
+
+    const Color lossColor = stats.packetLoss > 0.05f || stats.retransmits > 10 ? ORANGE : WHITE;
+    DrawText(TextFormat("Rtt %.1f ms | jitter %.1f ms | ENet rtt %u ms", stats.rtt * 1000.0, stats.rttJitter * 1000.0, stats.enetRtt), x, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Loss %.1f%% | resends %u/s | receive stalls %u", stats.packetLoss * 100.f, stats.retransmits, stats.receiveStalls), x, y, fontSize, lossColor);
+    y += lineHeight;
+
+    const std::array<const char *, NetworkStats::maxChannels> channelNames{{"reliable", "snapshots", "clock", "-"}};
+    for (size_t i = 0; i < NetworkManager::channelCount && i < NetworkStats::maxChannels; i++)
+    {
+        const NetworkStats::ChannelTraffic &channel = stats.channels[i];
+        DrawText(TextFormat("%s: out %u pkt/s %u B/s | in %u pkt/s %u B/s", channelNames[i], channel.packetsOut, channel.bytesOut, channel.packetsIn, channel.bytesIn), x, y, fontSize, WHITE);
+        y += lineHeight;
     }
+    DrawText(TextFormat("Wire (with ENet) out %u B/s | in %u B/s", stats.wireBytesOut, stats.wireBytesIn), x, y, fontSize, WHITE);
+    y += lineHeight;
+    DrawText(TextFormat("Queues now/peak: recv %u/%u | in %u/%u | out %u/%u", stats.receiveQueue.current, stats.receiveQueue.peak, stats.incomingQueue.current,
+                        stats.incomingQueue.peak, stats.outgoingQueue.current, stats.outgoingQueue.peak),
+             x, y, fontSize, WHITE);
 }
 
-void Game::update()
+void Game::update(float step)
 {
     std::unordered_map<Entity *, float> pendingDamage;
     std::unordered_set<Entity *> shooters;
@@ -391,14 +876,7 @@ void Game::update()
             pendingDamage[target] += dmg;
             shooters.insert(attacker);
 
-            if (dynamic_cast<Artillery*>(attacker))
-            {
-                AudioManager::getInstance().Play(SoundId::ArtilleryAttack, 0.8f);
-            }
-            else
-            {
-                AudioManager::getInstance().Play(SoundId::NormalAttack, 0.1f);
-			}
+            events.push_back(GameEvent{GameEventType::AttackFired, attacker->getKind(), attacker->getTeam(), attacker->getID(), attacker->getPosition(), false});
 
             const int team = attacker->getTeam();
             if (team == 0 || team == 1)
@@ -409,42 +887,49 @@ void Game::update()
     }
 
 	// +1 for every 20 damage dealt; currency reward
-    const int localTeam = runAsServer ? 0 : 1;
-    damageBank[(size_t)localTeam] += damageDealtThisFrame[(size_t)localTeam];
-    if (damageBank[(size_t)localTeam] >= 20.f) // at least 20 damage dealt
+    // the authoritative host also keeps the books for the client, which no longer simulates
+    for (int team = 0; team < 2; team++)
     {
-        const int earned = (int)(damageBank[(size_t)localTeam] / 20.f);
+        const bool local = team == (runAsServer ? 0 : 1);
+        if (!local && !(runAsServer && netMode == NetMode::Authoritative))
+            continue;
+
+        damageBank[(size_t)team] += damageDealtThisFrame[(size_t)team];
+        if (damageBank[(size_t)team] < 20.f) // at least 20 damage dealt
+            continue;
+
+        const int earned = (int)(damageBank[(size_t)team] / 20.f);
         // could be exploited if damage dealt is extremely high
+        // the cap was 2 per frame at 120 fps; per tick it is the same rate, whatever the tick rate
+        const int tickCap = (int)(maxEarnedPerSecond * step + 0.5f);
+        const int cap = tickCap > 1 ? tickCap : 1;
 #ifdef _WIN32
-        const int cappedEarned = min(earned, 2); // max 2 currency per frame
+        const int cappedEarned = min(earned, cap); // max currency per tick
 #else
-        const int cappedEarned = std::min(earned, 2); // max 2 currency per frame
+        const int cappedEarned = std::min(earned, cap); // max currency per tick
 #endif
         //int cappedEarned = fmin(earned, 2); // max 2 currency per frame
-        currency += cappedEarned;
-        damageBank[(size_t)localTeam] -= 20.f * (float)cappedEarned;
+        (local ? currency : remoteCurrency) += cappedEarned;
+        if (local)
+            earnedCurrency += cappedEarned;
+        damageBank[(size_t)team] -= 20.f * (float)cappedEarned;
     }
 
     // apply all attacks
-    for (auto &[target, dmg] : pendingDamage)
+    // in entity order, not hash map order: lockstep peers must apply (and stop at a destroyed base) identically
+    for (Entity *target : entities)
     {
-        if (!target)
+        auto pending = pendingDamage.find(target);
+        if (!target || pending == pendingDamage.end())
             continue;
+        const float dmg = pending->second;
 
         target->setHealth(target->getHealth() - dmg);
 
         if (dynamic_cast<Base *>(target) && target->getHealth() <= 0)
         {
             endGame = true;
-            endText = std::string((target->getTeam() == 0) ? "The Flag goes to Player 2!" : "The Flag goes to Player 1!");
-
-            AudioManager::getInstance().PlayMusic();
-
-			if ((target->getTeam() == 0 && runAsServer) || (target->getTeam() == 1 && !runAsServer))
-                AudioManager::getInstance().Play(SoundId::Defeat);
-            else
-				AudioManager::getInstance().Play(SoundId::Victory);
-
+            events.push_back(GameEvent{GameEventType::BaseDestroyed, UnitKind::Base, target->getTeam(), target->getID(), target->getPosition(), false});
             return;
         }
     }
@@ -461,7 +946,10 @@ void Game::update()
 
         startPos.reserve(entities.size());
         startPos.emplace(entity, entity->getPosition());
-        entity->update(dt, shooters.find(entity) != shooters.end());
+        entity->update(step, shooters.find(entity) != shooters.end());
+
+        if (entity->getPosition() != startPos[entity])
+            events.push_back(GameEvent{GameEventType::UnitMarching, entity->getKind(), entity->getTeam(), entity->getID(), entity->getPosition(), false});
     }
 
     // remove dead entities
@@ -470,7 +958,10 @@ void Game::update()
         Entity *entity = *it;
         if (!entity || entity->getHealth() <= 0)
         {
-            delete entity;
+            if (entity)
+                events.push_back(GameEvent{GameEventType::UnitDied, entity->getKind(), entity->getTeam(), entity->getID(), entity->getPosition(), false});
+
+            deleteEntity(entity);
             it = entities.erase(it);
             continue;
         }
@@ -479,6 +970,10 @@ void Game::update()
 
     // resolve movement collisions between entities
     resolveCollisions();
+
+    // the grid only changes for entities that moved into other cells this tick
+    for (Entity *entity : entities)
+        trackEntity(entity);
 }
 
 bool Game::resolveCollisions()
@@ -577,7 +1072,7 @@ void Game::restartGame()
             continue;
         }
 
-        delete entity;
+        deleteEntity(entity);
         it = entities.erase(it);
     }
 
@@ -586,14 +1081,22 @@ void Game::restartGame()
     damageBank = {{0.f, 0.f}};
     endText = "";
     endGame = false;
+    events.clear();
+    simTick = 0;
+    remoteCurrency = 30;
+    earnedCurrency = 0;
+    lastSnapshotTick = 0;
+    lastSpectatorTick = 0;
     beginGame = true;
     dt = 0.f;
+    simAccumulator = 0.f;
     startPos.clear();
     nextLocalEntitySeq = 1;
     lastReceived = "";
     selectedTroop = false;
     selectedEntity = nullptr;
     mousePoint = {0, 0};
+    camera.reset({(float)screenWidth, (float)screenHeight});
     // reset to starting game screen -> reconnection of players needed
 }
 
@@ -602,7 +1105,7 @@ void Game::destroyEntityPtr(Entity *entity)
     auto ent = std::find(entities.begin(), entities.end(), entity);
     if (ent != entities.end())
     {
-        delete *ent;
+        deleteEntity(*ent);
         entities.erase(ent);
     }
 }
@@ -617,7 +1120,7 @@ void Game::destroyEntityID(int id)
 
     if (it != entities.end())
     {
-        delete *it;         // delete the object
+        deleteEntity(*it);  // delete the object
         entities.erase(it); // remove pointer from vector
     }
 }
@@ -635,87 +1138,931 @@ void Game::startNetworkThread()
 void Game::stopNetworkThread()
 {
     networkThreadRunning = false;
+    network.wake();
     if (networkThread.joinable())
         networkThread.join();
 }
 
+bool Game::canIssueCommand() const
+{
+    if (!exchangesTickFrames())
+        return true; // a full frame is flushed and a new one started
+
+    // exactly one frame per tick: input beyond it waits for the next tick instead of being lost (and paid for)
+    size_t issued = pendingCommands.header.count;
+    for (const GameEvent &event : events)
+        if (event.local && (event.type == GameEventType::Spawn || event.type == GameEventType::OrderIssued))
+            issued++;
+    return issued < maxCommandsPerFrame;
+}
+
 void Game::sendPacket(const PacketData &pkt)
 {
-    std::lock_guard<std::mutex> lock(outgoingMutex);
-    outgoingPackets.push(pkt);
+    if (pendingCommands.header.count == maxCommandsPerFrame)
+    {
+        if (exchangesTickFrames())
+            return; // not reached, canIssueCommand() refuses the input first
+        flushCommands();
+    }
+
+    pendingCommands.commands[pendingCommands.header.count++] = pkt;
+}
+
+void Game::flushCommands()
+{
+    if (pendingCommands.header.count == 0 || exchangesTickFrames()) // sent with the next tick instead
+        return;
+
+    pendingCommands.header.type = MessageType::Commands;
+    pendingCommands.header.tick = simTick;
+
+    OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE);
+    if (message) // a full queue drops the frame and counts it
+    {
+        std::memcpy(message->data, &pendingCommands, pendingCommands.byteSize());
+        endMessage(message, pendingCommands.byteSize());
+    }
+    pendingCommands.header.count = 0;
+}
+
+OutgoingMessage *Game::beginMessage(uint8_t channel, uint32_t flags, Recipients recipients)
+{
+    OutgoingMessage *message = outgoingMessages.beginPush();
+    if (!message)
+        return nullptr;
+
+    message->channel = channel;
+    message->flags = flags;
+    message->recipients = recipients;
+    message->size = 0;
+    return message;
+}
+
+void Game::endMessage(OutgoingMessage *message, size_t size)
+{
+    message->size = (uint32_t)size;
+    outgoingMessages.endPush();
+    network.wake(); // sent right away instead of at the network thread's next timeout
 }
 
 void Game::getPacketsIn()
 {
-    for (;;)
+    ENetPacket *packet = nullptr;
+    while (incomingPackets.pop(packet))
     {
-        PacketData pkt{};
+        FrameHeader header{};
+        if (packet->dataLength >= sizeof(FrameHeader))
+            std::memcpy(&header, packet->data, sizeof(FrameHeader));
+
+        switch (header.type)
+        {
+        case MessageType::Commands:
         {
-            std::lock_guard<std::mutex> lock(incomingMutex);
-            if (incomingPackets.empty())
+            // unpack the whole frame in one pass
+            if (packet->dataLength < sizeof(FrameHeader) + header.count * sizeof(PacketData))
                 break;
-            pkt = incomingPackets.front();
-            incomingPackets.pop();
-        }
 
-        // process packet (game logic, no networking calls)
-        switch (pkt.type)
-        {
-        case TroopType::Infantry:
-        {
-            Vector2 spawnPos = (runAsServer) ? startPosPlayer2 : startPosPlayer1;
-            Entity *ent = new Infantry(spawnPos, runAsServer ? 1 : 0, Vector2{(float)pkt.desiredPos[0], (float)pkt.desiredPos[1]});
-            ent->setID(pkt.entityId);
-            entities.push_back(ent);
+            if (exchangesTickFrames())
+            {
+                // kept until its tick runs
+                if (header.count <= maxCommandsPerFrame)
+                    std::memcpy(&remoteFrames[header.tick % lockstepWindow], packet->data, sizeof(FrameHeader) + header.count * sizeof(PacketData));
+
+                // the tick already ran without these commands (predicted empty)
+                if (netMode == NetMode::Rollback && header.count > 0 && header.tick < simTick && header.tick < rollbackFrom)
+                    rollbackFrom = header.tick;
+                break;
+            }
+
+            // run when our tick clock reaches the frame's tick, not whenever it happened to arrive
+            CommandFrame *frame = commandBacklog.empty() ? scheduledCommands.beginPush() : nullptr;
+            if (frame && header.count <= maxCommandsPerFrame)
+            {
+                std::memcpy(frame, packet->data, sizeof(FrameHeader) + header.count * sizeof(PacketData));
+                scheduledCommands.endPush();
+                break;
+            }
+
+            // no room while a resync is coming: the world they would run on now is about to be replaced,
+            // they wait behind the queued frames instead
+            if ((resyncPending || !commandBacklog.empty()) && header.count <= maxCommandsPerFrame)
+            {
+                commandBacklog.emplace_back();
+                std::memcpy(&commandBacklog.back(), packet->data, sizeof(FrameHeader) + header.count * sizeof(PacketData));
+                break;
+            }
+
+            // no room: right away, as before
+            const uint8_t *records = packet->data + sizeof(FrameHeader);
+            for (uint16_t c = 0; c < header.count; c++)
+            {
+                PacketData pkt{};
+                std::memcpy(&pkt, records + c * sizeof(PacketData), sizeof(PacketData));
+                handleCommand(pkt, runAsServer ? 1 : 0);
+            }
             break;
         }
-        case TroopType::Cavallry:
+        case MessageType::Config:
         {
-            Vector2 spawnPos = (runAsServer) ? startPosPlayer2 : startPosPlayer1;
-            Entity *ent = new Cavalry(spawnPos, runAsServer ? 1 : 0, Vector2{(float)pkt.desiredPos[0], (float)pkt.desiredPos[1]});
-            ent->setID(pkt.entityId);
-            entities.push_back(ent);
+            ConfigMessage config{};
+            if (!runAsServer && packet->dataLength >= sizeof(ConfigMessage))
+            {
+                std::memcpy(&config, packet->data, sizeof(ConfigMessage));
+                if ((uint8_t)config.mode > (uint8_t)NetMode::Rollback)
+                {
+                    // a newer or broken host: no ticks run until a config we understand arrives
+                    std::cerr << "Ignoring config with unknown net mode " << (int)config.mode << "\n";
+                    configReceived = false;
+                    break;
+                }
+                if (config.resync)
+                {
+                    resyncPending = true;
+                    resyncData.clear();
+                    resyncOffset = 0;
+                }
+                spectating = config.spectator != 0;
+                netMode = spectating ? NetMode::Authoritative : config.mode; // spectators only ever replicate
+                lastAppliedSnapshot = 0;
+                if (config.simRateIndex < simRates.size())
+                {
+                    if (exchangesTickFrames())
+                        simRateIndex = config.simRateIndex;
+                    snapshotInterpolator.setTickRate((float)simRates[config.simRateIndex]);
+                }
+                configReceived = true;
+            }
             break;
         }
-        case TroopType::Artillery:
+        case MessageType::Checksum:
         {
-            Vector2 spawnPos = (runAsServer) ? startPosPlayer2 : startPosPlayer1;
-            Entity *ent = new Artillery(spawnPos, runAsServer ? 1 : 0, Vector2{(float)pkt.desiredPos[0], (float)pkt.desiredPos[1]});
-            ent->setID(pkt.entityId);
-            entities.push_back(ent);
+            if (header.count > checksumInterval || packet->dataLength < sizeof(FrameHeader) + header.count * sizeof(uint32_t) || header.tick + 1 < header.count)
+                break;
+
+            const uint8_t *hashes = packet->data + sizeof(FrameHeader);
+            for (uint16_t i = 0; i < header.count; i++)
+            {
+                const uint32_t tick = header.tick + 1 - header.count + i;
+                std::memcpy(&remoteHashes[tick % checksumWindow], hashes + i * sizeof(uint32_t), sizeof(uint32_t));
+                remoteHashTicks[tick % checksumWindow] = tick;
+                compareTickHash(tick);
+            }
             break;
         }
-        case TroopType::Change:
-        {
-            auto it = std::find_if(entities.begin(), entities.end(), [&](Entity *e)
-                                   { return e && e->getID() == pkt.entityId; });
-
-            if (it != entities.end())
+        case MessageType::Resync:
+            if (!runAsServer && resyncPending)
+                receiveResyncChunk(packet);
+            break;
+        case MessageType::SnapshotAck:
+            if (runAsServer && header.tick > ackedSnapshotTick)
+            {
+                // snapshots sent between the last acknowledged one and this one were lost (or overtaken)
+                size_t lost = 0;
+                for (const SnapshotRecord &record : snapshotHistory)
+                    if (record.valid && record.tick > ackedSnapshotTick && record.tick < header.tick)
+                        lost++;
+                if (ackedSnapshotTick)
+                    congestion.onSnapshotAck(lost);
+                ackedSnapshotTick = header.tick;
+            }
+            break;
+        case MessageType::Snapshot:
+            // the spectator stream is a chain of deltas, each one the baseline of the next, none may be skipped
+            if (spectating && pendingSnapshot)
+            {
+                applySnapshot(pendingSnapshot);
+                network.releasePacket(pendingSnapshot);
+                pendingSnapshot = nullptr;
+            }
+            // otherwise only the newest one matters, it is applied on the next tick
+            if (!runAsServer && header.tick > lastAppliedSnapshot)
             {
-                (*it)->setDesiredPosition(Vector2{(float)pkt.desiredPos[0], (float)pkt.desiredPos[1]});
+                if (pendingSnapshot)
+                    network.releasePacket(pendingSnapshot);
+                pendingSnapshot = packet;
+                pendingSnapshotTime = GetTime();
+                packet = nullptr;
             }
             break;
+        default:
+            break;
         }
-        case TroopType::None:
-        {
-            // nothing got sent
+
+        if (packet)
+            network.releasePacket(packet); // plain free, safe outside the network thread
+    }
+}
+
+void Game::runScheduledCommands(uint32_t tick)
+{
+    while (const CommandFrame *frame = scheduledCommands.front())
+    {
+        if (frame->header.tick > tick && (catchingUp || frame->header.tick - tick <= maxCommandLeadTicks))
             break;
+
+        for (uint16_t i = 0; i < frame->header.count; i++)
+            handleCommand(frame->commands[i], runAsServer ? 1 : 0);
+        scheduledCommands.popFront();
+    }
+
+    // arrived after the queue was full, so they come after all of it
+    while (!commandBacklog.empty() && scheduledCommands.size() == 0)
+    {
+        const CommandFrame &frame = commandBacklog.front();
+        if (frame.header.tick > tick && (catchingUp || frame.header.tick - tick <= maxCommandLeadTicks))
+            break;
+
+        for (uint16_t i = 0; i < frame.header.count; i++)
+            handleCommand(frame.commands[i], runAsServer ? 1 : 0);
+        commandBacklog.pop_front();
+    }
+}
+
+float Game::tickClockCorrection(float simStep)
+{
+    tickClockError = 0.f;
+    if (runAsServer || netMode == NetMode::Lockstep) // the host is the reference, lockstep is paced by frames
+        return 1.f;
+
+    double epoch;
+    float rate;
+    if (!network.getRemoteTickClock(epoch, rate))
+        return catchingUp ? 0.f : 1.f; // a rejoin waits for the first clock sample to know how far to catch up
+    if (rate != (float)simRates[simRateIndex])
+    {
+        if (catchingUp)
+            finishResume(); // different tick rates, nothing to line up with
+        return 1.f;
+    }
+
+    const double hostTick = (NetworkManager::clockNow() - epoch) * rate;
+    tickClockError = (float)(hostTick - (simTick + simAccumulator / simStep));
+
+    // rejoined: run the ticks the host ran since the resync state, as many per frame as allowed
+    if (catchingUp)
+    {
+        if (tickClockError < 1.f)
+            finishResume();
+        else
+            simAccumulator += tickClockError * simStep;
+        return 1.f;
+    }
+
+    // far off (joined late, long stall): independent ticks only label commands, so just take over the host's
+    if (netMode != NetMode::Rollback && std::fabs(tickClockError) > tickJumpThreshold && hostTick > 0.0)
+    {
+        simTick = (uint32_t)hostTick;
+        simAccumulator = 0.f;
+        return 1.f;
+    }
+
+    return 1.f + std::clamp(tickClockError * 0.01f, -maxTickRateCorrection, maxTickRateCorrection);
+}
+
+void Game::handleCommand(const PacketData &pkt, int senderTeam)
+{
+    // process packet (game logic, no networking calls)
+    const Vector2 desiredPos{(float)pkt.desiredPos[0], (float)pkt.desiredPos[1]};
+
+    switch (pkt.type)
+    {
+    case TroopType::Infantry:
+    case TroopType::Cavallry:
+    case TroopType::Artillery:
+    {
+        // a replica gets the unit through the next snapshot instead
+        if (isReplica())
+            break;
+
+        // a peer only spawns for its own team, with ids from its own range
+        const int team = (pkt.entityId >> 24) & 0xFF;
+        if (team != senderTeam)
+            break;
+
+        const UnitKind kind = pkt.type == TroopType::Infantry ? UnitKind::Infantry : pkt.type == TroopType::Cavallry ? UnitKind::Cavalry : UnitKind::Artillery;
+        if (runAsServer && netMode == NetMode::Authoritative)
+        {
+            // the client cannot spend what it does not have (the host's own spawns never come through here)
+            if (remoteCurrency < unitCost(kind))
+                break;
+            remoteCurrency -= unitCost(kind);
         }
-        default:
+
+        Vector2 spawnPos = team == 0 ? startPosPlayer1 : startPosPlayer2;
+        Entity *ent = createEntity(kind, team, spawnPos, desiredPos);
+        ent->setID(pkt.entityId);
+        entities.push_back(ent);
+        trackEntity(ent);
+        events.push_back(GameEvent{GameEventType::Spawn, ent->getKind(), ent->getTeam(), ent->getID(), desiredPos, false});
+        break;
+    }
+    case TroopType::Change:
+    {
+        auto it = std::find_if(entities.begin(), entities.end(), [&](Entity *e)
+                               { return e && e->getID() == pkt.entityId; });
+
+        if (it != entities.end() && (*it)->getTeam() == senderTeam) // only its own units
+        {
+            (*it)->setDesiredPosition(desiredPos);
+            events.push_back(GameEvent{GameEventType::OrderIssued, (*it)->getKind(), (*it)->getTeam(), pkt.entityId, desiredPos, false});
+        }
+        break;
+    }
+    case TroopType::None:
+    {
+        // nothing got sent
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Game::announceMode()
+{
+    if (modeAnnounced || !queueConfig(Recipients::Player))
+        return; // retried next frame
+
+    modeAnnounced = true;
+    spectatorsConfigured = false; // their tick rate may have changed too
+}
+
+bool Game::queueConfig(Recipients recipients)
+{
+    OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE, recipients);
+    if (!message)
+        return false;
+
+    ConfigMessage config{};
+    config.header = FrameHeader{MessageType::Config, 0, simTick};
+    config.mode = netMode;
+    config.simRateIndex = (uint8_t)simRateIndex;
+    config.spectator = recipients == Recipients::Player ? 0 : 1;
+    config.resync = recipients == Recipients::Player && !resyncData.empty() && resyncOffset == 0 ? 1 : 0;
+    std::memcpy(message->data, &config, sizeof(config));
+    endMessage(message, sizeof(config));
+    return true;
+}
+
+void Game::captureStates(std::vector<EntityState> &states) const
+{
+    states.clear();
+    for (const Entity *entity : entities)
+        if (entity)
+            states.push_back(entity->captureState());
+
+    std::sort(states.begin(), states.end(), [](const EntityState &a, const EntityState &b)
+              { return a.id < b.id; });
+}
+
+Game::SnapshotRecord *Game::findSnapshot(uint32_t tick)
+{
+    for (SnapshotRecord &record : snapshotHistory)
+        if (record.valid && record.tick == tick)
+            return &record;
+    return nullptr;
+}
+
+Game::SnapshotRecord &Game::storeSnapshot(uint32_t tick, std::vector<EntityState> &states)
+{
+    // oldest slot first; swapping keeps the vectors' capacity, no allocation at steady state
+    SnapshotRecord &record = snapshotHistory[snapshotHistoryNext];
+    snapshotHistoryNext = (snapshotHistoryNext + 1) % snapshotHistory.size();
+
+    record.valid = true;
+    record.tick = tick;
+    record.states.swap(states);
+    return record;
+}
+
+void Game::resetSnapshotHistory()
+{
+    for (SnapshotRecord &record : snapshotHistory)
+        record.valid = false;
+    snapshotHistoryNext = 0;
+    ackedSnapshotTick = 0;
+    replicationScheduler.reset();
+}
+
+void Game::queueSnapshot()
+{
+    OutgoingMessage *message = beginMessage(snapshotChannel, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+    if (!message)
+        return;
+
+    // keep exactly what the client will decode, deltas compare against that
+    captureStates(snapshotScratch);
+    snapshotCodec.roundTrip(snapshotScratch);
+
+    const SnapshotRecord *baseline = ackedSnapshotTick ? findSnapshot(ackedSnapshotTick) : nullptr;
+    const SnapshotRecord *latest = findSnapshot(lastSnapshotTick);
+    static const std::vector<EntityState> noBaseline;
+
+    // the bytes the send rate allows since the last snapshot; entities that do not fit keep what the client got last
+    const float sinceLast = (float)(simTick - lastSnapshotTick) / (float)simRates[simRateIndex];
+    const float elapsed = sinceLast < 0.5f ? sinceLast : 0.5f;
+    const size_t budget = (size_t)((float)replicationBytesPerSecond * elapsed);
+    replicationScheduler.select(snapshotCodec, elapsed, budget > sizeof(SnapshotHeader) ? budget - sizeof(SnapshotHeader) : 0, snapshotScratch,
+                                baseline ? &baseline->states : nullptr, latest ? &latest->states : nullptr, replicationScratch);
+
+    SnapshotHeader header{};
+    header.header = FrameHeader{MessageType::Snapshot, (uint16_t)replicationScratch.size(), simTick};
+    header.clientCurrency = remoteCurrency;
+    std::memcpy(message->data, &header, sizeof(header));
+
+    const size_t payload = snapshotCodec.encode(simTick, baseline ? baseline->tick : 0, baseline ? baseline->states : noBaseline, replicationScratch,
+                                                message->data + sizeof(SnapshotHeader), sizeof(message->data) - sizeof(SnapshotHeader));
+    if (payload == 0)
+    {
+        std::cerr << "Snapshot of " << replicationScratch.size() << " entities does not fit a message\n";
+        return; // slot not committed, reused by the next message
+    }
+
+    endMessage(message, sizeof(SnapshotHeader) + payload);
+    storeSnapshot(simTick, replicationScratch);
+
+    lastSnapshotTick = simTick;
+    lastSnapshotBytes = sizeof(SnapshotHeader) + payload;
+}
+
+void Game::queueSpectatorSnapshot()
+{
+    // config, join and shared snapshot go out together or not at all, a gap would break the delta chain
+    if (outgoingMessages.capacity() - outgoingMessages.size() < 3)
+        return;
+
+    // newcomers learn the mode and tick rate first, on the same reliable channel as the snapshots
+    const bool joining = network.getJoiningSpectatorCount() > 0;
+    if ((joining || !spectatorsConfigured) && !queueConfig(Recipients::Spectators))
+        return;
+    spectatorsConfigured = true;
+
+    captureStates(spectatorScratch);
+    snapshotCodec.roundTrip(spectatorScratch);
+
+    // encoded once into one pooled packet that every spectator's peer references
+    auto encode = [this](Recipients recipients, uint32_t baselineTick, const std::vector<EntityState> &baseline) -> bool
+    {
+        OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE, recipients);
+        if (!message)
+            return false;
+
+        SnapshotHeader header{};
+        header.header = FrameHeader{MessageType::Snapshot, (uint16_t)spectatorScratch.size(), simTick};
+        std::memcpy(message->data, &header, sizeof(header));
+
+        const size_t payload = snapshotCodec.encode(simTick, baselineTick, baseline, spectatorScratch,
+                                                    message->data + sizeof(SnapshotHeader), sizeof(message->data) - sizeof(SnapshotHeader));
+        if (payload == 0)
+        {
+            std::cerr << "Spectator snapshot of " << spectatorScratch.size() << " entities does not fit a message\n";
+            return false;
+        }
+
+        endMessage(message, sizeof(SnapshotHeader) + payload);
+        lastSpectatorBytes = sizeof(SnapshotHeader) + payload;
+        return true;
+    };
+
+    // the join snapshot goes out first, the shared delta of the same tick is then already stale for them
+    static const std::vector<EntityState> noBaseline;
+    if (joining && !encode(Recipients::JoiningSpectators, 0, noBaseline))
+        return;
+    if (!encode(Recipients::Spectators, lastSpectatorTick, lastSpectatorTick ? spectatorStates : noBaseline))
+        return;
+
+    spectatorStates.swap(spectatorScratch);
+    lastSpectatorTick = simTick;
+}
+
+void Game::onLinkUp()
+{
+    linkUp = true;
+    linkConnection = network.getConnectionCount();
+    resumeStartTime = GetTime();
+    if (runAsServer && simTick > 0)
+        beginResync(); // the player rejoined mid-match, or someone new took the seat
+}
+
+void Game::onLinkDown()
+{
+    // the world stays as it is: the host keeps listening, the client's network thread reconnects
+    linkUp = false;
+    std::cout << "Connection lost at tick " << simTick << ", waiting for the peer to rejoin\n";
+
+    // what belonged to the lost connection
+    modeAnnounced = false;
+    configReceived = false;
+    resyncPending = false;
+    catchingUp = false;
+    resyncData.clear();
+    resyncOffset = 0;
+    scheduledCommands.clear();
+    commandBacklog.clear();
+    if (!exchangesTickFrames())
+        pendingCommands.header.count = 0; // already applied here, the resync state carries them
+    if (pendingSnapshot)
+    {
+        network.releasePacket(pendingSnapshot);
+        pendingSnapshot = nullptr;
+    }
+    resetSnapshotHistory();
+    snapshotInterpolator.reset();
+    congestion.reset();
+}
+
+void Game::restartTickFrames(uint32_t tick)
+{
+    // the player's frames for the ticks its commands can no longer reach are empty, on both sides
+    std::array<CommandFrame, lockstepWindow> &playerFrames = runAsServer ? remoteFrames : localFrames;
+    for (uint32_t t = tick; t < tick + commandDelayTicks(); t++)
+        playerFrames[t % lockstepWindow].header = FrameHeader{MessageType::Commands, 0, t};
+
+    localHashTicks.fill(UINT32_MAX);
+    remoteHashTicks.fill(UINT32_MAX);
+    lastVerifiedTick = tick;
+    desynced = false;
+
+    for (RollbackFrame &frame : rollbackFrames)
+        frame.tick = UINT32_MAX;
+    announcedSpawns.clear();
+    confirmedTick = tick;
+    rollbackFrom = UINT32_MAX;
+}
+
+void Game::beginResync()
+{
+    // both sides continue from the state as the client decodes it, in id order: the same world bit for bit
+    captureStates(resyncStates);
+    snapshotCodec.roundTrip(resyncStates);
+    restoreEntities(resyncStates.data(), resyncStates.size());
+    for (Entity *entity : entities)
+        entity->storePreviousPosition();
+
+    resyncTick = simTick;
+    restartTickFrames(resyncTick);
+
+    static const std::vector<EntityState> noBaseline;
+    size_t capacity = 64 + resyncStates.size() * 16;
+    size_t snapshotBytes = 0;
+    while (snapshotBytes == 0 && capacity <= (1u << 24))
+    {
+        resyncData.resize(sizeof(ResyncState) + capacity);
+        snapshotBytes = snapshotCodec.encode(resyncTick, 0, noBaseline, resyncStates, resyncData.data() + sizeof(ResyncState), capacity);
+        capacity *= 2;
+    }
+    if (snapshotBytes == 0)
+    {
+        std::cerr << "Resync state of " << resyncStates.size() << " entities could not be encoded\n";
+        resyncData.clear();
+        return;
+    }
+
+    ResyncState state{};
+    state.damageBank[0] = damageBank[0];
+    state.damageBank[1] = damageBank[1];
+    state.entityCount = (uint32_t)resyncStates.size();
+    state.snapshotBytes = (uint32_t)snapshotBytes;
+
+    size_t size = sizeof(ResyncState) + snapshotBytes;
+    resyncData.resize(size + (resyncStates.size() + 7) / 8);
+    std::fill(resyncData.begin() + size, resyncData.end(), (uint8_t)0);
+    for (size_t i = 0; i < resyncStates.size(); i++)
+        if (resyncStates[i].halted)
+            resyncData[size + i / 8] |= (uint8_t)(1u << (i % 8));
+    size = resyncData.size();
+
+    // our frames for the next ticks already went out to the lost connection
+    if (exchangesTickFrames())
+    {
+        for (uint32_t tick = resyncTick; tick < resyncTick + commandDelayTicks(); tick++)
+        {
+            CommandFrame frame = localFrames[tick % lockstepWindow];
+            if (frame.header.type != MessageType::Commands || frame.header.tick != tick)
+                frame.header = FrameHeader{MessageType::Commands, 0, tick}; // before the first frame was due
+            resyncData.resize(size + frame.byteSize());
+            std::memcpy(resyncData.data() + size, &frame, frame.byteSize());
+            size = resyncData.size();
+            state.frameCount++;
+        }
+    }
+    std::memcpy(resyncData.data(), &state, sizeof(state));
+
+    resyncOffset = 0;
+    lastResyncBytes = resyncData.size();
+    modeAnnounced = false; // the config tells the client a resync follows
+    std::cout << "Player joined at tick " << resyncTick << ", sending " << resyncData.size() << " bytes of state\n";
+}
+
+void Game::streamResync()
+{
+    if (resyncData.empty() || resyncOffset >= resyncData.size() || !modeAnnounced)
+        return; // the config goes first
+
+    // as much as the queue takes, the rest next frame; ENet keeps the reliable chunks in order
+    const uint16_t chunkCount = (uint16_t)((resyncData.size() + resyncChunkBytes - 1) / resyncChunkBytes);
+    while (resyncOffset < resyncData.size() && outgoingMessages.capacity() - outgoingMessages.size() > resyncReservedSlots)
+    {
+        OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE);
+        if (!message)
+            break;
+
+        const size_t remaining = resyncData.size() - resyncOffset;
+        const size_t size = remaining < resyncChunkBytes ? remaining : resyncChunkBytes;
+
+        ResyncChunk chunk{};
+        chunk.header = FrameHeader{MessageType::Resync, (uint16_t)(resyncOffset / resyncChunkBytes), resyncTick};
+        chunk.chunkCount = chunkCount;
+        chunk.totalSize = (uint32_t)resyncData.size();
+        std::memcpy(message->data, &chunk, sizeof(chunk));
+        std::memcpy(message->data + sizeof(chunk), resyncData.data() + resyncOffset, size);
+        endMessage(message, sizeof(chunk) + size);
+        resyncOffset += size;
+    }
+
+    if (resyncOffset == resyncData.size())
+        std::cout << "Resync of tick " << resyncTick << " queued in " << chunkCount << " chunks\n";
+}
+
+void Game::receiveResyncChunk(const ENetPacket *packet)
+{
+    ResyncChunk chunk{};
+    if (packet->dataLength < sizeof(chunk))
+        return;
+    std::memcpy(&chunk, packet->data, sizeof(chunk));
+    const size_t size = packet->dataLength - sizeof(chunk);
+
+    if (chunk.header.count == 0)
+    {
+        resyncData.resize(chunk.totalSize);
+        resyncOffset = 0;
+        resyncTick = chunk.header.tick;
+    }
+
+    // reliable and in order; anything else is left over from a transfer the host gave up on
+    if (chunk.header.tick != resyncTick || chunk.totalSize != resyncData.size() || chunk.header.count != resyncOffset / resyncChunkBytes || size > resyncData.size() - resyncOffset)
+        return;
+
+    std::memcpy(resyncData.data() + resyncOffset, packet->data + sizeof(chunk), size);
+    resyncOffset += size;
+    if (resyncOffset == resyncData.size())
+        applyResync();
+}
+
+void Game::applyResync()
+{
+    ResyncState state{};
+    if (resyncData.size() < sizeof(state))
+        return;
+    std::memcpy(&state, resyncData.data(), sizeof(state));
+
+    const uint8_t *snapshot = resyncData.data() + sizeof(state);
+    const size_t haltedBytes = (state.entityCount + 7) / 8;
+    static const std::vector<EntityState> noBaseline;
+    if (sizeof(state) + state.snapshotBytes + haltedBytes > resyncData.size() ||
+        !snapshotCodec.decode(snapshot, state.snapshotBytes, noBaseline, resyncStates) || resyncStates.size() != state.entityCount)
+    {
+        std::cerr << "Resync state of tick " << resyncTick << " could not be decoded\n";
+        return;
+    }
+
+    const uint8_t *halted = snapshot + state.snapshotBytes;
+    for (size_t i = 0; i < resyncStates.size(); i++)
+        resyncStates[i].halted = (halted[i / 8] >> (i % 8)) & 1;
+
+    restoreEntities(resyncStates.data(), resyncStates.size());
+    for (Entity *entity : entities)
+        entity->storePreviousPosition();
+    damageBank = {{state.damageBank[0], state.damageBank[1]}};
+    simTick = resyncTick;
+    simAccumulator = 0.f;
+    endGame = false;
+
+    // a fresh client taking the seat must not hand out ids its team already uses
+    const int team = runAsServer ? 0 : 1;
+    for (const EntityState &s : resyncStates)
+        if (((s.id >> 24) & 0xFF) == team && (s.id & 0x00FFFFFF) >= nextLocalEntitySeq)
+            nextLocalEntitySeq = (s.id & 0x00FFFFFF) + 1;
+
+    restartTickFrames(resyncTick);
+    const uint8_t *frames = halted + haltedBytes;
+    const uint8_t *end = resyncData.data() + resyncData.size();
+    for (uint8_t f = 0; f < state.frameCount && (size_t)(end - frames) >= sizeof(FrameHeader); f++)
+    {
+        FrameHeader header{};
+        std::memcpy(&header, frames, sizeof(header));
+        const size_t bytes = sizeof(FrameHeader) + header.count * sizeof(PacketData);
+        if (header.count > maxCommandsPerFrame || bytes > (size_t)(end - frames))
             break;
+        std::memcpy(&remoteFrames[header.tick % lockstepWindow], frames, bytes);
+        frames += bytes;
+    }
+
+    resyncPending = false;
+    lastResyncBytes = resyncData.size();
+    resyncData.clear();
+
+    // independent mode replays what the host ran meanwhile, the other modes pick up from here
+    catchingUp = netMode == NetMode::Independent;
+    if (!catchingUp)
+        finishResume();
+}
+
+void Game::finishResume()
+{
+    catchingUp = false;
+    lastResumeMs = (float)((GetTime() - resumeStartTime) * 1000.0);
+    std::cout << "Resumed at tick " << simTick << ", " << lastResumeMs << " ms after reconnecting (" << lastResyncBytes << " bytes of state)\n";
+}
+
+void Game::applySnapshot(const ENetPacket *packet)
+{
+    SnapshotHeader header{};
+    if (packet->dataLength < sizeof(SnapshotHeader))
+        return;
+    std::memcpy(&header, packet->data, sizeof(header));
+
+    const uint8_t *payload = packet->data + sizeof(SnapshotHeader);
+    const size_t payloadSize = packet->dataLength - sizeof(SnapshotHeader);
+
+    uint32_t tick = 0;
+    uint32_t baselineTick = 0;
+    if (!SnapshotCodec::peekHeader(payload, payloadSize, tick, baselineTick))
+        return;
+
+    // a baseline that already left our history cannot be decoded; the host falls back to a full snapshot
+    // once its acknowledgements stop matching
+    static const std::vector<EntityState> noBaseline;
+    const SnapshotRecord *baseline = baselineTick ? findSnapshot(baselineTick) : nullptr;
+    if (baselineTick && !baseline)
+        return;
+
+    if (!snapshotCodec.decode(payload, payloadSize, baseline ? baseline->states : noBaseline, snapshotScratch))
+        return;
+
+    const SnapshotRecord *previous = lastAppliedSnapshot ? findSnapshot(lastAppliedSnapshot) : nullptr;
+    applySnapshotStates(snapshotScratch, previous ? &previous->states : nullptr);
+    snapshotInterpolator.addSnapshot(tick, pendingSnapshotTime, snapshotScratch);
+    storeSnapshot(tick, snapshotScratch);
+
+    lastAppliedSnapshot = tick;
+    lastSnapshotBytes = packet->dataLength;
+    if (spectating)
+        return; // nothing to acknowledge, the stream is reliable
+    currency = header.clientCurrency;
+
+    // the host encodes the next snapshots against this one
+    OutgoingMessage *message = beginMessage(snapshotChannel, 0);
+    if (message)
+    {
+        const FrameHeader ack{MessageType::SnapshotAck, 0, tick};
+        std::memcpy(message->data, &ack, sizeof(ack));
+        endMessage(message, sizeof(ack));
+    }
+}
+
+void Game::interpolateReplica()
+{
+    // a replica does not simulate, its entity positions only serve rendering and picking
+    snapshotInterpolator.beginFrame(GetTime());
+    for (Entity *entity : entities)
+    {
+        Vector2 position;
+        if (!entity || entity->getKind() == UnitKind::Base || !snapshotInterpolator.sample(entity->getID(), position))
+            continue;
+
+        entity->setPosition(position);
+        entity->storePreviousPosition();
+        trackEntity(entity);
+    }
+}
+
+void Game::applySnapshotStates(const std::vector<EntityState> &states, const std::vector<EntityState> *previous)
+{
+    std::unordered_map<int, Entity *> byId;
+    byId.reserve(entities.size());
+    for (Entity *entity : entities)
+        if (entity)
+            byId.emplace(entity->getID(), entity);
+
+    std::unordered_set<int> present;
+    present.reserve(states.size());
+
+    for (const EntityState &state : states)
+    {
+        present.insert(state.id);
+
+        auto it = byId.find(state.id);
+        Entity *entity = it != byId.end() ? it->second : nullptr;
+        if (!entity)
+        {
+            if (state.kind == UnitKind::Base || state.kind > UnitKind::Base)
+                continue; // bases always exist locally
+
+            entity = createEntity(state.kind, state.team, state.position, state.desiredPosition);
+            entity->setID(state.id);
+            entity->storePreviousPosition();
+            entities.push_back(entity);
+            // our own spawns were announced when the input was handled
+            if (state.team != (runAsServer ? 0 : 1))
+                events.push_back(GameEvent{GameEventType::Spawn, state.kind, state.team, state.id, state.desiredPosition, false});
+        }
+
+        // the same events the local simulation would have produced
+        if (state.shooting && !entity->getShooting())
+            events.push_back(GameEvent{GameEventType::AttackFired, state.kind, state.team, state.id, state.position, false});
+        // against the host's previous state, the local position moves with the interpolation every frame
+        if (state.kind != UnitKind::Base && previous)
+        {
+            auto before = std::lower_bound(previous->begin(), previous->end(), state.id, [](const EntityState &s, int32_t id)
+                                           { return s.id < id; });
+            if (before != previous->end() && before->id == state.id && before->position != state.position)
+                events.push_back(GameEvent{GameEventType::UnitMarching, state.kind, state.team, state.id, state.position, false});
+        }
+
+        entity->applyState(state);
+        trackEntity(entity);
+
+        if (state.kind == UnitKind::Base && state.health <= 0.f && !endGame)
+        {
+            endGame = true;
+            events.push_back(GameEvent{GameEventType::BaseDestroyed, UnitKind::Base, state.team, state.id, state.position, false});
         }
     }
+
+    // whatever the host no longer has died there
+    for (auto it = entities.begin(); it != entities.end();)
+    {
+        Entity *entity = *it;
+        if (entity && (present.count(entity->getID()) || entity->getKind() == UnitKind::Base))
+        {
+            ++it;
+            continue;
+        }
+
+        if (entity)
+            events.push_back(GameEvent{GameEventType::UnitDied, entity->getKind(), entity->getTeam(), entity->getID(), entity->getPosition(), false});
+        deleteEntity(entity);
+        it = entities.erase(it);
+    }
+}
+
+void Game::toggleReplayRecording()
+{
+    if (replay.isOpen())
+    {
+        replay.close();
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories("replays", error);
+    replay.open(TextFormat("replays/match_%lld.ctfr", (long long)time(nullptr)));
+}
+
+void Game::toggleNetworkStatsLog()
+{
+    if (netStatsLog.isOpen())
+    {
+        netStatsLog.close();
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories("netstats", error);
+    netStatsLog.open(TextFormat("netstats/%s_%lld.csv", runAsServer ? "host" : "client", (long long)time(nullptr)));
 }
 
 void Game::networkThreadMain()
 {
     bool connectAttemptStarted = false;
+    std::string serverIP;
+    enet_uint16 serverPort = gamePort;
+
+    // CTF_SERVER="host[:port]" skips the LAN discovery, e.g. to go through the host's link simulation
+    if (const char *address = std::getenv("CTF_SERVER"))
+    {
+        serverIP = address;
+        const size_t colon = serverIP.find(':');
+        if (colon != std::string::npos)
+        {
+            serverPort = (enet_uint16)std::atoi(serverIP.c_str() + colon + 1);
+            serverIP.resize(colon);
+        }
+    }
 
     while (networkThreadRunning)
     {
+        // lost the server (or it did not answer): dial the same address again, the host resyncs us
+        if (!runAsServer && connectAttemptStarted && network.isConnectionLost())
+        {
+            network.shutdown();
+            clientConnected = false;
+            connectAttemptStarted = false;
+        }
+
         if (!runAsServer && !connectAttemptStarted)
         {
-            std::string serverIP;
             while (networkThreadRunning && serverIP.empty())
             {
                 serverIP = DiscoverServer(12345, 5);
@@ -723,44 +2070,45 @@ void Game::networkThreadMain()
 
             if (!serverIP.empty() && networkThreadRunning)
             {
-                network.startClient(serverIP, 1234);
+                network.startClient(serverIP, serverPort);
                 connectAttemptStarted = true;
             }
         }
 
-        // send outgoing packets
-        {
-            std::lock_guard<std::mutex> lock(outgoingMutex);
-            while (!outgoingPackets.empty())
-            {
-                PacketData pkt = outgoingPackets.front();
-                outgoingPackets.pop();
-                network.send(pkt);
-            }
-        }
-
-        // Poll enet events -> incoming packets
-        for (int i = 0; i < 5; i++)
+        // send outgoing messages, one flush for all of them; each is copied once into a pooled send buffer
+        while (OutgoingMessage *message = outgoingMessages.front())
         {
-            auto packet = network.pollEvent();
-            if (!packet.has_value())
-                break;
-            if (packet->size() < sizeof(PacketData))
-                continue;
+            uint8_t *buffer = network.acquireSendBuffer();
+            if (!buffer)
+                break; // pool busy with in-flight packets, the rest goes out next iteration
 
-            PacketData pkt{};
-            std::memcpy(&pkt, packet->data(), sizeof(PacketData));
-
-            {
-                std::lock_guard<std::mutex> lock(incomingMutex);
-                incomingPackets.push(pkt);
-            }
+            std::memcpy(buffer, message->data, message->size);
+            network.sendBuffer(buffer, message->size, message->channel, message->flags, message->recipients);
+            outgoingMessages.popFront();
         }
+        network.flush();
+
+        // Poll enet events -> incoming packets, parsed by the game thread. Nothing is dropped: while the
+        // incoming queue is full the packets wait in the network manager, and behind it in ENet
+        network.service();
+        ENetPacket *packet = nullptr;
+        bool incomingFull = false;
+        while (!(incomingFull = incomingPackets.size() == incomingPackets.capacity()) && network.takePacket(packet))
+            incomingPackets.push(packet);
+        if (incomingFull)
+            incomingStalls.fetch_add(1, std::memory_order_relaxed);
+        network.sampleQueues(incomingPackets.size(), outgoingMessages.size(), incomingStalls.load(std::memory_order_relaxed));
 
         // update variable for main loop
         clientConnected = network.isConnected();
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // sleeps until a datagram arrives or the game queues a frame; the timeout keeps
+        // ENet's resend and keep-alive timers running while nothing happens
+        // while backed up the socket stays readable, give the game thread a moment to drain instead of spinning
+        if (incomingFull)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        else
+            network.waitForActivity(networkWaitTimeoutMs);
     }
 }
 
@@ -771,7 +2119,17 @@ void Game::startNetworking()
 
     if (runAsServer)
     {
-        network.startServer(1234);
+        network.startServer(gamePort);
+
+        // CTF_LINK_SIM="latency=80,jitter=20,loss=0.02,...": clients on linkSimulationPort get that network
+        if (const char *linkSimulation = std::getenv("CTF_LINK_SIM"))
+        {
+            LinkConditions conditions;
+            if (LinkConditions::parse(linkSimulation, conditions))
+                network.startLinkSimulation(linkSimulationPort, conditions, conditions);
+            else
+                std::cerr << "CTF_LINK_SIM not understood: " << linkSimulation << "\n";
+        }
         clientConnected = false;
         broadcastThread = std::thread([this]()
                                       {
@@ -788,6 +2146,317 @@ void Game::startNetworking()
     }
 }
 
+bool Game::lockstepFrameReady(uint32_t tick) const
+{
+    if (tick < commandDelayTicks())
+        return true; // nobody could issue commands for the first ticks, both sides treat them as empty
+
+    const CommandFrame &frame = remoteFrames[tick % lockstepWindow];
+    return frame.header.type == MessageType::Commands && frame.header.tick == tick;
+}
+
+bool Game::sendLockstepFrame(uint32_t tick)
+{
+    // sent even when empty, the peer cannot run this tick without it
+    OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE);
+    if (!message)
+        return false; // queue full: pendingCommands stay for the next attempt
+
+    pendingCommands.header.type = MessageType::Commands;
+    pendingCommands.header.tick = tick;
+    localFrames[tick % lockstepWindow] = pendingCommands;
+
+    std::memcpy(message->data, &pendingCommands, pendingCommands.byteSize());
+    endMessage(message, pendingCommands.byteSize());
+    pendingCommands.header.count = 0;
+    return true;
+}
+
+void Game::runLockstepCommands(uint32_t tick)
+{
+    if (tick < commandDelayTicks())
+        return;
+
+    // the same order on both peers: team 0 (host) first
+    const CommandFrame &local = localFrames[tick % lockstepWindow];
+    const CommandFrame &remote = remoteFrames[tick % lockstepWindow];
+    const CommandFrame &first = runAsServer ? local : remote;
+    const CommandFrame &second = runAsServer ? remote : local;
+
+    const CommandFrame *frames[] = {&first, &second};
+    for (int team = 0; team < 2; team++)
+        if (frames[team]->header.tick == tick)
+            for (uint16_t i = 0; i < frames[team]->header.count; i++)
+                handleCommand(frames[team]->commands[i], team);
+}
+
+void Game::resetLockstep()
+{
+    for (CommandFrame &frame : localFrames)
+        frame.header = FrameHeader{MessageType::Commands, 0, UINT32_MAX};
+    for (CommandFrame &frame : remoteFrames)
+        frame.header = FrameHeader{MessageType::Commands, 0, UINT32_MAX};
+
+    localHashTicks.fill(UINT32_MAX);
+    remoteHashTicks.fill(UINT32_MAX);
+    lastVerifiedTick = 0;
+    desynced = false;
+    desyncTick = 0;
+    lockstepStalls = 0;
+    configReceived = false;
+
+    for (RollbackFrame &frame : rollbackFrames)
+        frame.tick = UINT32_MAX;
+    announcedSpawns.clear();
+    confirmedTick = 0;
+    rollbackFrom = UINT32_MAX;
+    maxRollbackDepth = 0;
+    maxResimMs = 0.f;
+    rollbackCount = 0;
+}
+
+void Game::simulateRollbackTick(uint32_t tick, float step)
+{
+    saveRollbackFrame(tick);
+    const size_t firstEvent = events.size();
+    runLockstepCommands(tick); // a missing remote frame is skipped, i.e. predicted empty
+    update(step);
+    rollbackHashes[tick % rollbackWindow] = hashSimulationState();
+
+    // a unit is announced once: when its tick first ran, or by the rollback that brought its late command
+    events.erase(std::remove_if(events.begin() + firstEvent, events.end(), [&](const GameEvent &event)
+                                { return event.type == GameEventType::Spawn && !announcedSpawns.emplace(event.entityId, tick).second; }),
+                 events.end());
+}
+
+void Game::rollBack(float step)
+{
+    if (rollbackFrom >= simTick)
+        return;
+
+    const uint32_t from = rollbackFrom;
+    rollbackFrom = UINT32_MAX;
+
+    const double start = GetTime();
+    if (!restoreRollbackFrame(from))
+    {
+        std::cerr << "Rollback to tick " << from << " is out of the saved window\n";
+        return;
+    }
+
+    // sounds and effects of these ticks already played once, only spawns of late commands are new
+    const size_t eventCount = events.size();
+    for (uint32_t tick = from; tick < simTick && !endGame; tick++)
+    {
+        for (Entity *entity : entities)
+            entity->storePreviousPosition();
+        simulateRollbackTick(tick, step);
+    }
+    events.erase(std::remove_if(events.begin() + eventCount, events.end(), [](const GameEvent &event)
+                                { return event.type != GameEventType::Spawn; }),
+                 events.end());
+
+    rollbackDepthThisFrame = simTick - from;
+    resimMsThisFrame = (float)((GetTime() - start) * 1000.0);
+    if (rollbackDepthThisFrame > maxRollbackDepth)
+        maxRollbackDepth = rollbackDepthThisFrame;
+    if (resimMsThisFrame > maxResimMs)
+        maxResimMs = resimMsThisFrame;
+    rollbackCount++;
+
+    confirmRollbackTicks();
+}
+
+void Game::confirmRollbackTicks()
+{
+    // a tick is final once every frame up to it is known and none of them still asks for a rollback
+    while (confirmedTick < simTick && confirmedTick < rollbackFrom && lockstepFrameReady(confirmedTick))
+    {
+        recordTickHash(confirmedTick, rollbackHashes[confirmedTick % rollbackWindow]);
+        confirmedTick++;
+    }
+
+    // confirmed ticks never run again
+    std::erase_if(announcedSpawns, [this](const auto &entry)
+                  { return entry.second < confirmedTick; });
+}
+
+void Game::saveRollbackFrame(uint32_t tick)
+{
+    if (entities.size() > rollbackCapacity)
+    {
+        // re-layout the saved slices into a bigger block, rare: only when the unit count grows past it
+        const size_t capacity = entities.size() > rollbackCapacity * 2 ? entities.size() : rollbackCapacity * 2;
+        std::vector<EntityState> states(rollbackWindow * capacity);
+        for (size_t slot = 0; slot < rollbackWindow; slot++)
+            std::copy_n(rollbackStates.begin() + slot * rollbackCapacity, rollbackFrames[slot].count, states.begin() + slot * capacity);
+        rollbackStates.swap(states);
+        rollbackCapacity = capacity;
+    }
+
+    const size_t slot = tick % rollbackWindow;
+    EntityState *slice = rollbackStates.data() + slot * rollbackCapacity;
+
+    RollbackFrame &frame = rollbackFrames[slot];
+    frame.tick = tick;
+    frame.count = 0;
+    for (const Entity *entity : entities)
+        if (entity)
+            slice[frame.count++] = entity->captureState();
+    frame.earnedCurrency = earnedCurrency;
+    frame.damageBank = damageBank;
+}
+
+bool Game::restoreRollbackFrame(uint32_t tick)
+{
+    const size_t slot = tick % rollbackWindow;
+    const RollbackFrame &frame = rollbackFrames[slot];
+    if (frame.tick != tick)
+        return false;
+
+    restoreEntities(rollbackStates.data() + slot * rollbackCapacity, frame.count);
+
+    currency -= earnedCurrency - frame.earnedCurrency;
+    earnedCurrency = frame.earnedCurrency;
+    damageBank = frame.damageBank;
+    endGame = false; // ticks only run while the match is on
+    return true;
+}
+
+void Game::restoreEntities(const EntityState *states, size_t count)
+{
+    rollbackLookup.clear();
+    for (Entity *entity : entities)
+        if (entity)
+            rollbackLookup.emplace(entity->getID(), entity);
+
+    // same objects where they still exist, recreated where they died since; the saved order is the simulation order
+    rollbackEntities.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        const EntityState &state = states[i];
+
+        Entity *entity = nullptr;
+        auto it = rollbackLookup.find(state.id);
+        if (it != rollbackLookup.end() && it->second->getKind() == state.kind)
+        {
+            entity = it->second;
+            rollbackLookup.erase(it);
+        }
+        else if (state.kind != UnitKind::Base) // bases are never removed
+        {
+            entity = createEntity(state.kind, state.team, state.position, state.desiredPosition);
+            entity->setID(state.id);
+        }
+        else
+        {
+            continue;
+        }
+
+        entity->applyState(state);
+        trackEntity(entity);
+        rollbackEntities.push_back(entity);
+    }
+
+    // spawned after the saved tick
+    for (auto &[id, entity] : rollbackLookup)
+        deleteEntity(entity);
+    entities.swap(rollbackEntities);
+}
+
+uint32_t Game::hashSimulationState() const
+{
+    uint32_t hash = fnvOffsetBasis;
+    for (const Entity *entity : entities)
+    {
+        if (!entity)
+            continue;
+
+        // field by field, the struct has padding
+        const EntityState state = entity->captureState();
+        hash = fnv1aValue(state.id, hash);
+        hash = fnv1aValue(state.kind, hash);
+        hash = fnv1aValue(state.shooting, hash);
+        hash = fnv1aValue(state.halted, hash);
+        hash = fnv1aValue(state.position, hash);
+        hash = fnv1aValue(state.desiredPosition, hash);
+        hash = fnv1aValue(state.health, hash);
+        hash = fnv1aValue(state.cooldown, hash);
+    }
+    return hash;
+}
+
+void Game::recordTickHash(uint32_t tick, uint32_t hash)
+{
+    localHashes[tick % checksumWindow] = hash;
+    localHashTicks[tick % checksumWindow] = tick;
+    compareTickHash(tick);
+
+    if ((tick + 1) % checksumInterval != 0)
+        return;
+
+    // the hashes of the last checksumInterval ticks, so the first diverging tick can be named exactly
+    OutgoingMessage *message = beginMessage(reliableChannel, ENET_PACKET_FLAG_RELIABLE);
+    if (!message)
+        return;
+
+    const FrameHeader header{MessageType::Checksum, (uint16_t)checksumInterval, tick};
+    std::memcpy(message->data, &header, sizeof(header));
+    for (uint32_t i = 0; i < checksumInterval; i++)
+    {
+        const uint32_t hashed = localHashes[(tick + 1 - checksumInterval + i) % checksumWindow];
+        std::memcpy(message->data + sizeof(header) + i * sizeof(uint32_t), &hashed, sizeof(uint32_t));
+    }
+    endMessage(message, sizeof(header) + checksumInterval * sizeof(uint32_t));
+}
+
+void Game::compareTickHash(uint32_t tick)
+{
+    const size_t slot = tick % checksumWindow;
+    if (desynced || localHashTicks[slot] != tick || remoteHashTicks[slot] != tick)
+        return;
+
+    if (localHashes[slot] == remoteHashes[slot])
+    {
+        if (tick > lastVerifiedTick)
+            lastVerifiedTick = tick;
+        return;
+    }
+
+    // ticks are compared in order on both paths, so this is the first one that differs
+    desynced = true;
+    desyncTick = tick;
+    std::cerr << "Lockstep desync: simulation state differs from tick " << tick << " (last verified tick " << lastVerifiedTick << ")\n";
+}
+
+Entity *Game::createEntity(UnitKind kind, int team, Vector2 spawnPos, Vector2 desiredPos)
+{
+    switch (kind)
+    {
+    case UnitKind::Cavalry:
+        return new Cavalry(spawnPos, team, desiredPos);
+    case UnitKind::Artillery:
+        return new Artillery(spawnPos, team, desiredPos);
+    default:
+        return new Infantry(spawnPos, team, desiredPos);
+    }
+}
+
+int Game::unitCost(UnitKind kind) const
+{
+    switch (kind)
+    {
+    case UnitKind::Infantry:
+        return infantryCost;
+    case UnitKind::Cavalry:
+        return cavalryCost;
+    case UnitKind::Artillery:
+        return artilleryCost;
+    default:
+        return 0;
+    }
+}
+
 Entity *Game::searchForTroopAt(Vector2 worldPos)
 {
     for (auto &entity : entities)
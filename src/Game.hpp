@@ -7,20 +7,30 @@
 
 #include "raylib.h"
 #include "networking/NetworkManager.hpp"
+#include "networking/SnapshotCodec.hpp"
+#include "networking/SnapshotInterpolator.hpp"
+#include "networking/ReplicationScheduler.hpp"
+#include "networking/Replay.hpp"
 
 #include "core/Entity.hpp"
+#include "core/GameEvents.hpp"
 
 #include <string>
-#include <queue>
-#include <mutex>
 #include <thread>
 #include <atomic>
 #include <unordered_map>
 #include <array>
+#include <deque>
 
 #include "utils/Packets.hpp"
 #include "utils/Button.hpp"
 #include "utils/Filesystem.hpp"
+#include "utils/ViewCamera.hpp"
+#include "utils/SpatialGrid.hpp"
+#include "utils/TileStreamer.hpp"
+#include "utils/RenderQueue.hpp"
+#include "utils/DynamicResolution.hpp"
+#include "utils/FramePacer.hpp"
 
 constexpr const int screenWidth = 800;
 constexpr const int screenHeight = 800;
@@ -33,9 +43,30 @@ private:
     bool running = true;
 
     Vector2 mousePoint;
+    InputState input; // sampled by the frame pacer once per frame
+
+    FramePacer framePacer; // pacing mode cycled with F5
 
     Texture2D backgroundStart;
-	Texture2D backgroundGame;
+    TileStreamer backgroundGame; // battlefield background, streamed in tiles
+
+    const float backgroundTileSize = 200.f;               // world units per tile
+    const size_t backgroundBudgetBytes = 4 * 1024 * 1024; // resident tile textures
+
+    const int targetFps = 120;
+
+    RenderQueue renderQueue; // scene draw calls, sorted to minimize state changes
+
+    // scene resolution scaling, UI stays at native resolution
+    DynamicResolution dynamicResolution;
+    static constexpr std::array<float, 4> fixedRenderScales{{0.f, 1.f, 0.75f, 0.5f}}; // 0 = auto, cycled with F4
+    size_t renderScaleIndex = 0;
+
+    // camera and view culling
+    ViewCamera camera;
+    SpatialGrid<Entity *> visibilityGrid{worldWidth, worldHeight, 100.f}; // updated as entities change cells, see trackEntity()
+    std::vector<Entity *> visibleEntities;
+    const float entityDrawMargin = 120.f; // sprites and health bars reach beyond the collider
 
     // networking variables
     NetworkManager network;
@@ -46,12 +77,141 @@ private:
 
     std::atomic<bool> networkThreadRunning{false};
     std::thread networkThread;
-
-    std::queue<PacketData> incomingPackets;
-    std::mutex incomingMutex;
-
-    std::queue<PacketData> outgoingPackets;
-    std::mutex outgoingMutex;
+    static constexpr enet_uint32 networkWaitTimeoutMs = 10;
+    static constexpr enet_uint16 gamePort = 1234;
+    static constexpr enet_uint16 linkSimulationPort = 1235; // CTF_LINK_SIM on the host, CTF_SERVER=127.0.0.1:1235 on the client
+
+    // lock-free hand-off between the game thread and the network thread, neither side waits on the other
+    SpscQueue<ENetPacket *, 256> incomingPackets;    // network thread -> game thread, released by the game thread
+    std::atomic<size_t> incomingStalls{0};           // network thread found incomingPackets full and left packets queued
+    SpscQueue<OutgoingMessage, 8> outgoingMessages; // game thread -> network thread, encoded in place
+    CommandFrame pendingCommands{}; // commands of the current tick, not yet queued
+    SpscQueue<CommandFrame, 16> scheduledCommands; // peer frames waiting for their tick (only used by the game thread)
+    std::deque<CommandFrame> commandBacklog;       // frames behind a full scheduledCommands while a resync is pending
+    static constexpr uint32_t maxCommandLeadTicks = 60; // further ahead the clocks are not in sync yet, run it now
+
+    // the client's ticks follow the host's tick clock (clock sync in NetworkManager)
+    static constexpr float maxTickRateCorrection = 0.05f; // +-5% faster or slower
+    static constexpr float tickJumpThreshold = 30.f;      // ticks; independent mode jumps instead of catching up
+    float tickClockError = 0.f;                           // host tick - ours, for the overlay
+
+    // replication (F6 on the host): in authoritative mode the client stops simulating and applies snapshots
+    NetMode netMode = NetMode::Independent;
+    bool modeAnnounced = false;                 // host: config sent for the current netMode
+    int snapshotRate = 20;                      // snapshots per second sent by the host, follows the congestion controller
+    static constexpr int replayFrameRate = 20;  // replay frames per second
+    uint32_t lastSnapshotTick = 0;              // host: tick of the last snapshot sent
+    ENetPacket *pendingSnapshot = nullptr;      // client: newest snapshot not applied yet
+    double pendingSnapshotTime = 0.0;           // client: when it was received
+    uint32_t lastAppliedSnapshot = 0;           // client: tick of the last applied snapshot
+    int remoteCurrency = 30;                    // host: the client's currency in authoritative mode
+
+    // delta compression: the host encodes against the newest snapshot the client acknowledged,
+    // both sides keep the last few snapshots (as the client decoded them) to find that baseline
+    struct SnapshotRecord
+    {
+        bool valid = false;
+        uint32_t tick = 0;
+        std::vector<EntityState> states; // sorted by id, quantized
+    };
+    SnapshotCodec snapshotCodec;
+    std::array<SnapshotRecord, 32> snapshotHistory;
+    size_t snapshotHistoryNext = 0;
+    uint32_t ackedSnapshotTick = 0; // host: 0 = nothing acknowledged, send full snapshots
+    std::vector<EntityState> snapshotScratch;
+    size_t lastSnapshotBytes = 0;
+
+    // host: what fits the client's byte budget, by priority (one scheduler per replicated peer)
+    ReplicationScheduler replicationScheduler;
+    size_t replicationBytesPerSecond = 24 * 1024;
+    CongestionController congestion; // AIMD on the client's link, sets the two above
+    std::vector<EntityState> replicationScratch;
+
+    SnapshotInterpolator snapshotInterpolator; // client: replica positions rendered slightly in the past (F3)
+
+    // spectators (peers connecting while a player is there) get one shared stream, encoded once for all of
+    // them: full snapshots on the reliable channel, each a delta against the previous one. Newcomers first
+    // get a full snapshot of the same tick, so the shared deltas that follow apply for them too.
+    static constexpr int spectatorSnapshotRate = 10;
+    uint32_t lastSpectatorTick = 0;           // host: tick of the last spectator snapshot, the next one's baseline
+    std::vector<EntityState> spectatorStates; // host: as sent with it
+    std::vector<EntityState> spectatorScratch;
+    bool spectatorsConfigured = false;        // host: config sent to the spectators for the current mode
+    size_t lastSpectatorBytes = 0;
+    bool spectating = false;                  // client: watching read-only
+
+    // rejoin: a player (re)connecting mid-match gets the host's full state of one tick in chunks on the
+    // reliable channel, then the commands issued since. Both sides continue from exactly that state.
+    static constexpr size_t resyncChunkBytes = 4 * 1024;
+    static constexpr size_t resyncReservedSlots = 2;    // outgoing queue slots left to the other traffic
+    static constexpr int maxCatchUpStepsPerFrame = 32; // independent mode replays the ticks the host ran meanwhile
+    bool linkUp = false;               // the main loop ran with a peer last frame
+    uint32_t linkConnection = 0;       // NetworkManager::getConnectionCount() of that peer
+    std::vector<EntityState> resyncStates;
+    std::vector<uint8_t> resyncData;   // host: the state being streamed, client: being assembled
+    size_t resyncOffset = 0;           // bytes queued / received so far
+    uint32_t resyncTick = 0;
+    bool resyncPending = false;        // client: announced by the config, no ticks until it is applied
+    bool catchingUp = false;           // client: running the ticks the host ran since resyncTick
+    double resumeStartTime = 0.0;      // when the link came back
+    float lastResumeMs = 0.f;          // client: link back -> playing again
+    size_t lastResyncBytes = 0;
+
+    // lockstep: commands issued during tick T execute at T + inputDelayTicks on both peers. Every tick
+    // each peer sends its (possibly empty) command frame; a tick waits until the other peer's frame is in.
+    static constexpr uint32_t inputDelayTicks = 4;
+    static constexpr size_t lockstepWindow = 64; // ring of frames, well beyond the ticks peers can be apart
+    std::array<CommandFrame, lockstepWindow> localFrames{};
+    std::array<CommandFrame, lockstepWindow> remoteFrames{};
+    bool configReceived = false; // client: no ticks before the host told us the mode
+    size_t lockstepStalls = 0;   // ticks that had to wait for the peer, or for room to send our frame
+
+    // desync detection: a hash of the simulation state per tick, exchanged in batches
+    static constexpr uint32_t checksumInterval = 30; // ticks per Checksum message
+    static constexpr size_t checksumWindow = 256;
+    std::array<uint32_t, checksumWindow> localHashes{};
+    std::array<uint32_t, checksumWindow> localHashTicks{};
+    std::array<uint32_t, checksumWindow> remoteHashes{};
+    std::array<uint32_t, checksumWindow> remoteHashTicks{};
+    uint32_t lastVerifiedTick = 0;
+    bool desynced = false;
+    uint32_t desyncTick = 0; // first tick whose state differs between the peers
+
+    // rollback: ticks run with the peer's frame predicted as empty. The world is saved before every
+    // tick; when a late frame turns out to carry commands, the save of its tick is restored and the
+    // ticks since are simulated again within the same frame.
+    struct RollbackFrame
+    {
+        uint32_t tick = UINT32_MAX;
+        uint32_t count = 0;     // entity states in this tick's slice of rollbackStates
+        int earnedCurrency = 0; // rewards are the only currency the simulation itself hands out
+        std::array<float, 2> damageBank{{0.f, 0.f}};
+    };
+    static constexpr uint32_t rollbackInputDelayTicks = 1;
+    static constexpr uint32_t maxPredictionTicks = 8; // beyond that a tick waits like in lockstep
+    static constexpr size_t rollbackWindow = 16;
+    std::array<RollbackFrame, rollbackWindow> rollbackFrames;
+    std::vector<EntityState> rollbackStates; // one contiguous block: rollbackWindow slices of rollbackCapacity states
+    size_t rollbackCapacity = 0;
+    std::array<uint32_t, rollbackWindow> rollbackHashes{}; // per tick, handed to the desync check once confirmed
+    std::unordered_map<int, Entity *> rollbackLookup;     // reused by restores
+    std::vector<Entity *> rollbackEntities;
+    std::unordered_map<int, uint32_t> announcedSpawns; // unit id -> tick its Spawn event went out, until confirmed
+    uint32_t confirmedTick = 0;          // first tick that may still depend on a prediction
+    uint32_t rollbackFrom = UINT32_MAX;  // earliest tick that ran with a wrong prediction
+    int earnedCurrency = 0;              // local rewards from update(), undone by a restore
+
+    // rollback stats (overlay)
+    uint32_t rollbackDepthThisFrame = 0; // ticks simulated again this frame
+    float resimMsThisFrame = 0.f;
+    uint32_t maxRollbackDepth = 0;
+    float maxResimMs = 0.f;
+    size_t rollbackCount = 0;
+
+    ReplayWriter replay; // F7, records the match for the codec benchmark
+    NetworkStatsLog netStatsLog; // F9, a CSV line per network stats report
+    bool showNetworkOverlay = false; // F8
+    std::vector<EntityState> replayScratch;
 
     std::atomic<bool> runThread{true};
     std::thread broadcastThread;
@@ -59,9 +219,26 @@ private:
     // Entities
     std::vector<Entity *> entities;
 
+    // events of this frame's ticks and input, consumed in processEvents()
+    GameEventBuffer events;
+
     // game variables
     float dt; // delta time between frames
 
+    // fixed timestep simulation; rendering interpolates between the last two ticks
+    static constexpr std::array<int, 4> simRates{{20, 30, 60, 120}}; // ticks per second, cycled with F2
+    static constexpr int maxSimStepsPerFrame = 8;                    // drop time instead of spiralling after long stalls
+    size_t simRateIndex = 2;
+    float simAccumulator = 0.f;
+    uint32_t simTick = 0; // ticks since the match started, stamped on outgoing frames
+    bool interpolateRender = true; // toggled with F3
+
+    // perf overlay (F1)
+    bool showDebugOverlay = false;
+    int simTicksThisFrame = 0;
+    float simCpuMs = 0.f; // smoothed simulation cpu time per frame
+    size_t entitiesDrawn = 0;
+
     Vector2 startPosPlayer1 = {400, 600}; // team 0
     Vector2 startPosPlayer2 = {400, 200}; // team 1
 
@@ -81,6 +258,7 @@ private:
 
     // reward mechanic: every 20 damage dealt by a player grants +1 currency.
     std::array<float, 2> damageBank{{0.f, 0.f}};
+    static constexpr float maxEarnedPerSecond = 240.f; // reward cap, 2 per frame at the old fixed 120 fps
 
     const int income = 3;
 
@@ -114,16 +292,83 @@ private:
     void startNetworkThread();
     void stopNetworkThread();
     void networkThreadMain();
+    bool canIssueCommand() const; // room for one more local command in the current tick's frame
     void sendPacket(const PacketData &pkt);
+    void flushCommands(); // queue the commands collected this tick as one frame
     void getPacketsIn();
-
-    void update();
+    void handleCommand(const PacketData &pkt, int senderTeam); // lockstep runs the local player's commands through here too
+    void runScheduledCommands(uint32_t tick);
+    float tickClockCorrection(float simStep); // dt scale that pulls our tick toward the host's
+    bool exchangesTickFrames() const { return netMode == NetMode::Lockstep || netMode == NetMode::Rollback; }
+    bool appliesInputLocally() const { return !isReplica() && !exchangesTickFrames(); }
+    bool acceptsInput() const { return !spectating && !resyncPending && !catchingUp; }
+    uint32_t commandDelayTicks() const { return netMode == NetMode::Rollback ? rollbackInputDelayTicks : inputDelayTicks; }
+
+    bool lockstepFrameReady(uint32_t tick) const;
+    bool sendLockstepFrame(uint32_t tick); // pendingCommands become our frame for `tick`, false when the queue is full
+    void runLockstepCommands(uint32_t tick);
+    void resetLockstep();
+    uint32_t hashSimulationState() const;
+    void recordTickHash(uint32_t tick, uint32_t hash);
+    void compareTickHash(uint32_t tick);
+
+    void simulateRollbackTick(uint32_t tick, float step);
+    void rollBack(float step); // re-simulates from rollbackFrom, if a late frame asked for it
+    void confirmRollbackTicks();
+    void saveRollbackFrame(uint32_t tick);
+    bool restoreRollbackFrame(uint32_t tick);
+    void restoreEntities(const EntityState *states, size_t count); // in this order, no events
+
+    OutgoingMessage *beginMessage(uint8_t channel, uint32_t flags, Recipients recipients = Recipients::Player); // nullptr when the queue is full
+    void endMessage(OutgoingMessage *message, size_t size);
+
+    bool isReplica() const { return !runAsServer && netMode == NetMode::Authoritative; }
+    void announceMode();
+    bool queueConfig(Recipients recipients);
+
+    void onLinkUp();
+    void onLinkDown();
+    void beginResync();  // host: the state of this tick becomes the one both sides continue from
+    void streamResync(); // host: queues the next chunks
+    void receiveResyncChunk(const ENetPacket *packet);
+    void applyResync();
+    void finishResume();
+    void restartTickFrames(uint32_t tick); // lockstep and rollback go on from `tick`, nothing before it counts
+    void queueSnapshot();
+    void queueSpectatorSnapshot();
+    void applySnapshot(const ENetPacket *packet);
+    void applySnapshotStates(const std::vector<EntityState> &states, const std::vector<EntityState> *previous); // previous: the last applied snapshot, sorted by id
+    void interpolateReplica(); // moves replica entities to the interpolated render time
+    void captureStates(std::vector<EntityState> &states) const; // sorted by id
+    SnapshotRecord *findSnapshot(uint32_t tick);
+    SnapshotRecord &storeSnapshot(uint32_t tick, std::vector<EntityState> &states); // swaps `states` in
+    void resetSnapshotHistory();
+    void toggleReplayRecording();
+    void toggleNetworkStatsLog();
+
+    void stepSimulation();
+    void processEvents(); // audio, ui and network consumers, after the ticks of a frame
+    void processAudioEvents();
+    void processUiEvents();
+    void processNetworkEvents();
+
+    float getSimStep() const { return 1.f / (float)simRates[simRateIndex]; }
+    void update(float step);
     bool resolveCollisions();
     void restartGame();
 
+    Entity *createEntity(UnitKind kind, int team, Vector2 spawnPos, Vector2 desiredPos);
+    int unitCost(UnitKind kind) const;
     Entity *searchForTroopAt(Vector2 worldPos);
     int32_t allocateEntityId(int team);
 
     void destroyEntityPtr(Entity *entity);
     void destroyEntityID(int id);
+
+    void cullEntities(); // fills visibleEntities
+    void trackEntity(Entity *entity);  // after it was created or moved
+    void deleteEntity(Entity *entity); // instead of delete, the caller still erases it from entities
+    void handleDebugKeys();
+    void drawDebugOverlay();
+    void drawNetworkOverlay();
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <stdexcept>
 
 #include "../utils/Filesystem.hpp"
+#include "../utils/TextureCache.hpp"
 #include "../utils/ViewTransform.hpp"
 #include "../utils/Math.hpp"
 
@@ -20,13 +21,13 @@ Artillery::Artillery(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, te
 
     if (team == 0)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/artillery/blue_artilleryFull.png").c_str());
-        textureShooting = LoadTexture(FileSystem::getPath("res/artillery/blue_artilleryShoot.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/artillery/blue_artilleryFull.png"));
+        textureShooting = TextureCache::getInstance().load(FileSystem::getPath("res/artillery/blue_artilleryShoot.png"));
     }
     else if (team == 1)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/artillery/red_artilleryFull.png").c_str());
-        textureShooting = LoadTexture(FileSystem::getPath("res/artillery/red_artilleryShoot.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/artillery/red_artilleryFull.png"));
+        textureShooting = TextureCache::getInstance().load(FileSystem::getPath("res/artillery/red_artilleryShoot.png"));
     }
     else
         throw std::runtime_error("Invalid team for Artillery entity");
@@ -37,8 +38,8 @@ Artillery::Artillery(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, te
 
 Artillery::~Artillery()
 {
-    UnloadTexture(textureFull);
-    UnloadTexture(textureShooting);
+    TextureCache::getInstance().unload(textureFull);
+    TextureCache::getInstance().unload(textureShooting);
 }
 
 bool Artillery::canAttack() const
@@ -67,7 +68,7 @@ void Artillery::update(float dt, bool shotsFired)
     }
 }
 
-void Artillery::draw(bool inverted)
+void Artillery::draw(RenderQueue &queue, bool inverted, float alpha)
 {
     float ratio = health / maxHealth;
     Color barColor = math::HealthToColor(ratio);
@@ -82,7 +83,8 @@ void Artillery::draw(bool inverted)
 
     auto scale = 0.05f;
 
-    Vector2 viewPos = WorldToView(position, inverted);    
+    Vector2 renderPos = getRenderPosition(alpha);
+    Vector2 viewPos = WorldToView(renderPos, inverted);
 
     float offset;
     if (inverted)
@@ -109,23 +111,25 @@ void Artillery::draw(bool inverted)
     // if it is drawn from the client side, the texture will always be drawn inverted on the other side, no matter what team it belongs to
     if (inverted)
     {                                // from world to view coordinates
-        DrawEntityTexture(texture, viewPos, {(float)texture.width, (float)texture.height}, team == 0, scale); // flipped if other player
+        DrawEntityTexture(queue, texture, viewPos, {(float)texture.width, (float)texture.height}, team == 0, scale); // flipped if other player
     }
     else
     {
         // server = world coordinates
-        DrawEntityTexture(texture, position, {(float)texture.width, (float)texture.height}, team == 1, scale); // flipped if other player
+        DrawEntityTexture(queue, texture, renderPos, {(float)texture.width, (float)texture.height}, team == 1, scale); // flipped if other player
     }
 
 
+    // health bars of all entities go out in one untextured batch, sub layers keep back < front < frame
+
     // background
-    DrawRectangleRec(back, DARKGRAY);
+    queue.drawRectangle(RenderLayer::HealthBars, back, DARKGRAY, 0);
 
     // foreground - color
-    DrawRectangleRec(front, barColor);
+    queue.drawRectangle(RenderLayer::HealthBars, front, barColor, 1);
 
     // frame
-    DrawRectangleLinesEx(back, 1.0f, BLACK);
+    queue.drawRectangleLines(RenderLayer::HealthBars, back, 1.0f, BLACK, 2);
 }
 
 Vector2 Artillery::computeMovement(float dt)
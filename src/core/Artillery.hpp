@@ -35,6 +35,7 @@ public:
 
     int getID() const override { return id; }
     void setID(int newId) override { id = newId; }
+    UnitKind getKind() const override { return UnitKind::Artillery; }
 
     bool canAttack() const override;
     float getAttackRange() const override { return attackRange; }
@@ -47,13 +48,17 @@ public:
     float getHealth() const override { return health; }
     void setPosition(Vector2 pos) override { position = pos; }
     void setDesiredPosition(Vector2 pos) override { desiredPosition = pos; }
+    Vector2 getDesiredPosition() const override { return desiredPosition; }
     Vector2 getPosition() const override { return position; }
     int getTeam() const override { return team; }
     CircleCollider getCircleCollider() const override { return circle; }
     bool getShooting() const override { return isShooting; }
+    void setShooting(bool shooting) override { isShooting = shooting; }
+    float getCooldown() const override { return cooldownTimer; }
+    void setCooldown(float seconds) override { cooldownTimer = seconds; }
 
     void update(float dt, bool shotsFired) override;
-    void draw(bool inverted) override;
+    void draw(RenderQueue &queue, bool inverted, float alpha) override;
 
     Entity *bestEnt(const std::vector<Entity *> &entities) override;
 
@@ -4,6 +4,7 @@
 #include <stdexcept>
 
 #include "../utils/Filesystem.hpp"
+#include "../utils/TextureCache.hpp"
 #include "../utils/ViewTransform.hpp"
 #include "../utils/Math.hpp"
 
@@ -16,25 +17,28 @@ Base::Base(Vector2 pos, int team) : Entity(pos, team)
 
     if (team == 0)
     {
-        textureNormal = LoadTexture(FileSystem::getPath("res/base/blue_base.png").c_str());
-        textureInverted = LoadTexture(FileSystem::getPath("res/base/blue.png").c_str());
+        textureNormal = TextureCache::getInstance().load(FileSystem::getPath("res/base/blue_base.png"));
+        textureInverted = TextureCache::getInstance().load(FileSystem::getPath("res/base/blue.png"));
     }
     else if (team == 1)
     {
-        textureNormal = LoadTexture(FileSystem::getPath("res/base/red_base.png").c_str());
-        textureInverted = LoadTexture(FileSystem::getPath("res/base/red.png").c_str());
+        textureNormal = TextureCache::getInstance().load(FileSystem::getPath("res/base/red_base.png"));
+        textureInverted = TextureCache::getInstance().load(FileSystem::getPath("res/base/red.png"));
     }
     else
         throw std::runtime_error("Invalid team for Base entity");
 
+    // fixed position, known before the first draw (needed for view culling)
+    position = team == 1 ? player2BasePos : player1BasePos;
+
     // set collider
     circle.radius = 300.f;
 }
 
 Base::~Base()
 {
-    UnloadTexture(textureNormal);
-    UnloadTexture(textureInverted);
+    TextureCache::getInstance().unload(textureNormal);
+    TextureCache::getInstance().unload(textureInverted);
 }
 
 void Base::update(float dt, bool shotsFired)
@@ -42,7 +46,7 @@ void Base::update(float dt, bool shotsFired)
     // Base does not move
 }
 
-void Base::draw(bool inverted)
+void Base::draw(RenderQueue &queue, bool inverted, float alpha)
 {
     // calculate color
     float ratio = health / maxHealth;
@@ -101,20 +105,22 @@ void Base::draw(bool inverted)
     // if it is drawn from the client side, the texture will always be drawn inverted on the other side, no matter what team it belongs to
     if (inverted)
     {                                    // from world to view coordinates
-        DrawEntityTexture(texture, viewPos, {(float)texture.width, (float)texture.height}, team == 0, scale); // flipped if other player
+        DrawEntityTexture(queue, texture, viewPos, {(float)texture.width, (float)texture.height}, team == 0, scale, RenderLayer::Bases); // flipped if other player
     }
     else
     {
         // server = world coordinates
-        DrawEntityTexture(texture, pos, {(float)texture.width, (float)texture.height}, team == 1, scale); // flipped if other player
+        DrawEntityTexture(queue, texture, pos, {(float)texture.width, (float)texture.height}, team == 1, scale, RenderLayer::Bases); // flipped if other player
     }
 
+    // health bars of all entities go out in one untextured batch, sub layers keep back < front < frame
+
     // background
-    DrawRectangleRec(back, DARKGRAY);
+    queue.drawRectangle(RenderLayer::HealthBars, back, DARKGRAY, 0);
 
     // foreground - color
-    DrawRectangleRec(front, barColor);
+    queue.drawRectangle(RenderLayer::HealthBars, front, barColor, 1);
 
     // frame
-    DrawRectangleLinesEx(back, 1.0f, BLACK);
+    queue.drawRectangleLines(RenderLayer::HealthBars, back, 1.0f, BLACK, 2);
 }
@@ -27,6 +27,7 @@ public:
 
     int getID() const override { return id; }
     void setID(int newId) override { id = newId; }
+    UnitKind getKind() const override { return UnitKind::Base; }
 
     void setHealth(float hp) override
     {
@@ -36,6 +37,7 @@ public:
     float getHealth() const override { return health; }
     void setPosition(Vector2 pos) override { }; // Base position is fixed
     void setDesiredPosition(Vector2 pos) override { };
+    Vector2 getDesiredPosition() const override { return position; }
     Vector2 getPosition() const override { return position; }
     int getTeam() const override { return team; }
     CircleCollider getCircleCollider() const override { return circle; }
@@ -46,7 +48,7 @@ public:
     bool getShooting() const override { return false; };
 
     void update(float dt, bool shotsFired) override;
-    void draw(bool inverted) override;
+    void draw(RenderQueue &queue, bool inverted, float alpha) override;
 
 
     Entity* bestEnt(const std::vector<Entity*>& entities) override { return nullptr; };
@@ -4,9 +4,9 @@
 #include <stdexcept>
 
 #include "../utils/Filesystem.hpp"
+#include "../utils/TextureCache.hpp"
 #include "../utils/ViewTransform.hpp"
 #include "../utils/Math.hpp"
-#include "../utils/AudioManager.hpp"
 
 Cavalry::Cavalry(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, team)
 {
@@ -26,15 +26,15 @@ Cavalry::Cavalry(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, team)
 
     if (team == 0)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/cavalry/blue_cavalryFull.png").c_str());
-        textureInjured = LoadTexture(FileSystem::getPath("res/cavalry/blue_cavalryVer1.png").c_str());
-        textureInjured2 = LoadTexture(FileSystem::getPath("res/cavalry/blue_cavalryVer2.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/blue_cavalryFull.png"));
+        textureInjured = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/blue_cavalryVer1.png"));
+        textureInjured2 = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/blue_cavalryVer2.png"));
     }
     else if (team == 1)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/cavalry/red_cavalryFull.png").c_str());
-        textureInjured = LoadTexture(FileSystem::getPath("res/cavalry/red_cavalryVer1.png").c_str());
-        textureInjured2 = LoadTexture(FileSystem::getPath("res/cavalry/red_cavalryVer2.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/red_cavalryFull.png"));
+        textureInjured = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/red_cavalryVer1.png"));
+        textureInjured2 = TextureCache::getInstance().load(FileSystem::getPath("res/cavalry/red_cavalryVer2.png"));
     }
     else
         throw std::runtime_error("Invalid team for Cavalry entity");
@@ -47,9 +47,9 @@ Cavalry::Cavalry(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, team)
 
 Cavalry::~Cavalry()
 {
-    UnloadTexture(textureFull);
-    UnloadTexture(textureInjured);
-    UnloadTexture(textureInjured2);
+    TextureCache::getInstance().unload(textureFull);
+    TextureCache::getInstance().unload(textureInjured);
+    TextureCache::getInstance().unload(textureInjured2);
 }
 
 bool Cavalry::canAttack() const
@@ -76,13 +76,11 @@ void Cavalry::update(float dt, bool shotsFired)
     // compute movement always because cavalry can move while shooting
     if (attackMove)
     {
-        if (position != desiredPosition)
-			AudioManager::getInstance().Play(SoundId::March, 0.1f);
         position += computeMovement(dt);
     }
 }
 
-void Cavalry::draw(bool inverted)
+void Cavalry::draw(RenderQueue &queue, bool inverted, float alpha)
 {
     // draw the Cavalry texture based on health
     //
@@ -106,18 +104,20 @@ void Cavalry::draw(bool inverted)
         texture = textureInjured2;
     }
 
+    const Vector2 renderPos = getRenderPosition(alpha);
+
     for (const Vector2 &offset : formationOffsets)
     {
         // if it is drawn from the client side, the texture will always be drawn inverted on the other side, no matter what team it belongs to
         if (inverted)
         {
-            Vector2 viewPos = WorldToView(position + offset, inverted);                                    // from world to view coordinates
-            DrawEntityTexture(texture, viewPos, {(float)soldierSize, (float)soldierSize}, team == 0, 1.f); // flipped if other player
+            Vector2 viewPos = WorldToView(renderPos + offset, inverted);                                    // from world to view coordinates
+            DrawEntityTexture(queue, texture, viewPos, {(float)soldierSize, (float)soldierSize}, team == 0, 1.f); // flipped if other player
         }
         else
         {
             // server = world coordinates
-            DrawEntityTexture(texture, position + offset, {(float)soldierSize, (float)soldierSize}, team == 1, 1.f); // flipped if other player
+            DrawEntityTexture(queue, texture, renderPos + offset, {(float)soldierSize, (float)soldierSize}, team == 1, 1.f); // flipped if other player
         }
     }
 }
@@ -43,6 +43,7 @@ public:
 
     int getID() const override { return id; }
     void setID(int newId) override { id = newId; }
+    UnitKind getKind() const override { return UnitKind::Cavalry; }
 
     bool canAttack() const override;
     float getAttackRange() const override { return attackRange; }
@@ -58,14 +59,20 @@ public:
 	void setPosition(Vector2 pos) override{ position = pos; }
 	Vector2 getPosition() const override { return position; }
     void setDesiredPosition(Vector2 pos) override { desiredPosition = pos; }
+    Vector2 getDesiredPosition() const override { return desiredPosition; }
     int getTeam() const override { return team; }
     CircleCollider getCircleCollider() const override { return circle; }
 	bool getShooting() const override { return isShooting; }
+	void setShooting(bool shooting) override { isShooting = shooting; }
+	float getCooldown() const override { return cooldownTimer; }
+	void setCooldown(float seconds) override { cooldownTimer = seconds; }
 
     void setAttackMove(bool am) { attackMove = am; }
+    bool getHalted() const override { return !attackMove; }
+    void setHalted(bool halted) override { attackMove = !halted; }
 
     void update(float dt, bool shotsFired) override;
-    void draw(bool inverted) override;
+    void draw(RenderQueue &queue, bool inverted, float alpha) override;
     
 
 	Entity* bestEnt(const std::vector<Entity*>& entities) override;
@@ -1,13 +1,38 @@
 #pragma once
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include "raylib.h"
+#include "raymath.h"
+
+class RenderQueue;
 
 struct CircleCollider {
     float radius;
 };
 
+enum class UnitKind : uint8_t {
+    Infantry = 0,
+    Cavalry = 1,
+    Artillery = 2,
+    Base = 3
+};
+
+// plain copy of everything the simulation needs to recreate an entity (replication, rollback)
+struct EntityState
+{
+    int32_t id;
+    UnitKind kind;
+    uint8_t team;
+    bool shooting;
+    bool halted; // cavalry stopped by a base, not replicated
+    Vector2 position;
+    Vector2 desiredPosition;
+    float health;
+    float cooldown; // seconds since the last shot
+};
+
 class Entity
 {
 private:
@@ -25,14 +50,19 @@ private:
 public:
     bool isShooting;
 
+protected:
+    Vector2 previousPosition; // position at the start of the current simulation tick
+
 public:
-    Entity(Vector2 pos, int team) : position(pos), team(team) {}
+    Entity(Vector2 pos, int team) : position(pos), team(team), previousPosition(pos) {}
     virtual ~Entity() {}
 
     virtual int getID() const { return id; }
     virtual void setID(int newId) = 0;
+    virtual UnitKind getKind() const = 0;
 
     virtual void setDesiredPosition(Vector2 pos) = 0;
+    virtual Vector2 getDesiredPosition() const { return desiredPosition; }
     virtual void setPosition(Vector2 pos) = 0;
     virtual Vector2 getPosition() const { return position; } // get world position
     virtual int getTeam() const { return team; }
@@ -46,9 +76,35 @@ public:
     virtual float getAttackRange() const = 0;
 	virtual float getDamage() const = 0;
     virtual bool getShooting() const = 0;
+    virtual void setShooting(bool shooting) {}
+    virtual float getCooldown() const { return 0.f; }
+    virtual void setCooldown(float seconds) {}
+    virtual bool getHalted() const { return false; }
+    virtual void setHalted(bool halted) {}
 
 	virtual void update(float dt, bool sf) {}   // update ability to attack based on if shots fired
-    virtual void draw(bool inverted) {}
+    virtual void draw(RenderQueue &queue, bool inverted, float alpha) {} // alpha: interpolation factor between previous and current tick
+
+    // render interpolation between simulation ticks
+    void storePreviousPosition() { previousPosition = getPosition(); }
+    Vector2 getRenderPosition(float alpha) const { return Vector2Lerp(previousPosition, getPosition(), alpha); }
+
+    EntityState captureState() const
+    {
+        return EntityState{getID(), getKind(), (uint8_t)getTeam(), getShooting(), getHalted(), getPosition(), getDesiredPosition(), getHealth(), getCooldown()};
+    }
+
+    // team and kind are fixed at construction, everything else is overwritten
+    void applyState(const EntityState &state)
+    {
+        setPosition(state.position);
+        setDesiredPosition(state.desiredPosition);
+        if (getHealth() != state.health) // infantry and cavalry rebuild their formation on every set
+            setHealth(state.health);
+        setCooldown(state.cooldown);
+        setShooting(state.shooting);
+        setHalted(state.halted);
+    }
 
     virtual Entity* bestEnt(const std::vector<Entity*>& entities) = 0;
 
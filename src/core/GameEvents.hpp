@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+#include "Entity.hpp"
+
+// Things that happened during a simulation tick (or through local input).
+// The simulation only appends to the buffer; audio, UI and network consume it in batch afterwards.
+enum class GameEventType : uint8_t
+{
+    AttackFired,   // entityId = attacker, pos = attacker position
+    UnitDied,      // entityId = dead unit
+    BaseDestroyed, // team = team of the destroyed base
+    Spawn,         // entityId = new unit, pos = desired position
+    OrderIssued,   // entityId = ordered unit, pos = desired position
+    UnitMarching   // entityId = unit that moved this tick
+};
+
+struct GameEvent
+{
+    GameEventType type;
+    UnitKind kind;
+    int team;
+    int entityId;
+    Vector2 pos;
+    bool local; // caused by this player's input, has to be sent to the peer
+};
+
+using GameEventBuffer = std::vector<GameEvent>;
@@ -3,8 +3,8 @@
 #include <iostream>
 #include <stdexcept>
 
-#include "../utils/AudioManager.hpp"
 #include "../utils/Filesystem.hpp"
+#include "../utils/TextureCache.hpp"
 #include "../utils/ViewTransform.hpp"
 #include "../utils/Math.hpp"
 
@@ -25,15 +25,15 @@ Infantry::Infantry(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, team
 
     if (team == 0)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/infantry/blue_infantryFull.png").c_str());
-        textureInjured = LoadTexture(FileSystem::getPath("res/infantry/blue_infantryVer1.png").c_str());
-        textureInjured2 = LoadTexture(FileSystem::getPath("res/infantry/blue_infantryVer2.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/blue_infantryFull.png"));
+        textureInjured = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/blue_infantryVer1.png"));
+        textureInjured2 = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/blue_infantryVer2.png"));
     }
     else if (team == 1)
     {
-        textureFull = LoadTexture(FileSystem::getPath("res/infantry/red_infantryFull.png").c_str());
-        textureInjured = LoadTexture(FileSystem::getPath("res/infantry/red_infantryVer1.png").c_str());
-        textureInjured2 = LoadTexture(FileSystem::getPath("res/infantry/red_infantryVer2.png").c_str());
+        textureFull = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/red_infantryFull.png"));
+        textureInjured = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/red_infantryVer1.png"));
+        textureInjured2 = TextureCache::getInstance().load(FileSystem::getPath("res/infantry/red_infantryVer2.png"));
     }
     else
         throw std::runtime_error("Invalid team for Infantry entity");
@@ -46,9 +46,9 @@ Infantry::Infantry(Vector2 pos, int team, Vector2 desiredPos) : Entity(pos, team
 
 Infantry::~Infantry()
 {
-    UnloadTexture(textureFull);
-    UnloadTexture(textureInjured);
-    UnloadTexture(textureInjured2);
+    TextureCache::getInstance().unload(textureFull);
+    TextureCache::getInstance().unload(textureInjured);
+    TextureCache::getInstance().unload(textureInjured2);
 }
 
 bool Infantry::canAttack() const
@@ -73,13 +73,11 @@ void Infantry::update(float dt, bool shotsFired)
 
     if (!isShooting) // only move player if no shots fired; cannot move and shoot at the same time
     {
-		if (position != desiredPosition)
-			AudioManager::getInstance().Play(SoundId::March, 0.1f);
         position += computeMovement(dt);
     }
 }
 
-void Infantry::draw(bool inverted)
+void Infantry::draw(RenderQueue &queue, bool inverted, float alpha)
 {
     // draw the infantry texture based on health
     //
@@ -103,18 +101,20 @@ void Infantry::draw(bool inverted)
         texture = textureInjured2;
     }
 
+    const Vector2 renderPos = getRenderPosition(alpha);
+
     for (const Vector2 &offset : formationOffsets)
     {
         // if it is drawn from the client side, the texture will always be drawn inverted on the other side, no matter what team it belongs to
         if (inverted)
         {
-            Vector2 viewPos = WorldToView(position + offset, inverted);                                    // from world to view coordinates
-            DrawEntityTexture(texture, viewPos, {(float)soldierSize, (float)soldierSize}, team == 0, 1.f); // flipped if other player
+            Vector2 viewPos = WorldToView(renderPos + offset, inverted);                                    // from world to view coordinates
+            DrawEntityTexture(queue, texture, viewPos, {(float)soldierSize, (float)soldierSize}, team == 0, 1.f); // flipped if other player
         }
         else
         {
             // server = world coordinates
-            DrawEntityTexture(texture, position + offset, {(float)soldierSize, (float)soldierSize}, team == 1, 1.f); // flipped if other player
+            DrawEntityTexture(queue, texture, renderPos + offset, {(float)soldierSize, (float)soldierSize}, team == 1, 1.f); // flipped if other player
         }
     }
 }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Bit-granular writer into a caller owned buffer. Bits are packed LSB first; writing past the
+// end sets the overflow flag instead of touching memory, the caller checks once at the end.
+class BitWriter
+{
+public:
+    BitWriter(uint8_t *buffer, size_t capacity) : data(buffer), capacity(capacity) {}
+
+    void write(uint32_t value, int bits) // 1..32 bits
+    {
+        if (bits < 32)
+            value &= (1u << bits) - 1u;
+
+        scratch |= (uint64_t)value << scratchBits;
+        scratchBits += bits;
+
+        while (scratchBits >= 8)
+        {
+            if (bytes == capacity)
+            {
+                overflow = true;
+                scratchBits = 0;
+                return;
+            }
+            data[bytes++] = (uint8_t)scratch;
+            scratch >>= 8;
+            scratchBits -= 8;
+        }
+    }
+
+    void writeBool(bool value) { write(value ? 1u : 0u, 1); }
+
+    // small values are cheap: 4 data bits + 1 continuation bit per group
+    void writeVarUint(uint32_t value)
+    {
+        do
+        {
+            write(value & 0xF, 4);
+            value >>= 4;
+            writeBool(value != 0);
+        } while (value != 0);
+    }
+
+    // pads the last byte, returns the number of bytes used (0 after an overflow)
+    size_t finish()
+    {
+        if (scratchBits > 0)
+            write(0, 8 - scratchBits);
+        return overflow ? 0 : bytes;
+    }
+
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t *data;
+    size_t capacity;
+    size_t bytes = 0;
+    uint64_t scratch = 0;
+    int scratchBits = 0;
+    bool overflow = false;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *buffer, size_t size) : data(buffer), size(size) {}
+
+    uint32_t read(int bits) // 1..32 bits, reads zeros past the end and flags it
+    {
+        while (scratchBits < bits)
+        {
+            uint64_t next = 0;
+            if (bytes < size)
+                next = data[bytes++];
+            else
+                overflow = true;
+            scratch |= next << scratchBits;
+            scratchBits += 8;
+        }
+
+        const uint32_t value = (uint32_t)(scratch & (bits < 32 ? ((1ull << bits) - 1ull) : 0xFFFFFFFFull));
+        scratch >>= bits;
+        scratchBits -= bits;
+        return value;
+    }
+
+    bool readBool() { return read(1) != 0; }
+
+    uint32_t readVarUint()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 4)
+        {
+            value |= read(4) << shift;
+            if (!readBool())
+                return value;
+        }
+        overflow = true; // malformed, longer than 32 bits
+        return value;
+    }
+
+    bool overflowed() const { return overflow; }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t bytes = 0;
+    uint64_t scratch = 0;
+    int scratchBits = 0;
+    bool overflow = false;
+};
+
+// number of bits needed to store values 0..maxValue
+inline int bitsFor(uint32_t maxValue)
+{
+    int bits = 1;
+    while (bits < 32 && (maxValue >> bits) != 0)
+        bits++;
+    return bits;
+}
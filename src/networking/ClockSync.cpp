@@ -0,0 +1,66 @@
+#include "ClockSync.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void ClockSync::reset()
+{
+    samples = {};
+    sampleCount = 0;
+    nextSample = 0;
+    smoothedRtt = 0.0;
+    rttVariation = 0.0;
+    offset = 0.0;
+    offsetTime = 0.0;
+    drift = 0.0;
+}
+
+void ClockSync::addSample(double originTime, double replyTime, double receiveTime)
+{
+    const double rtt = receiveTime - originTime;
+    if (rtt < 0.0)
+        return;
+
+    // smoothed round trip and its variation, the gains TCP uses (RFC 6298)
+    if (sampleCount == 0)
+    {
+        smoothedRtt = rtt;
+        rttVariation = rtt / 2.0;
+    }
+    else
+    {
+        rttVariation += (std::fabs(smoothedRtt - rtt) - rttVariation) * 0.25;
+        smoothedRtt += (rtt - smoothedRtt) * 0.125;
+    }
+
+    samples[nextSample] = Sample{rtt, replyTime - (originTime + rtt / 2.0)};
+    nextSample = (nextSample + 1) % sampleWindow;
+    sampleCount = std::min(sampleCount + 1, sampleWindow);
+
+    const Sample *best = &samples[0];
+    for (size_t i = 1; i < sampleCount; i++)
+        if (samples[i].rtt < best->rtt)
+            best = &samples[i];
+
+    if (offsetTime == 0.0)
+    {
+        offset = best->offset;
+        offsetTime = receiveTime;
+        return;
+    }
+
+    // slew toward the best estimate; what remains after accounting for the known drift is new drift
+    const double elapsed = receiveTime - offsetTime;
+    const double predicted = getOffset(receiveTime);
+    const double error = best->offset - predicted;
+    if (elapsed > 0.0)
+        drift = std::clamp(drift + error / elapsed * 0.02, -1e-3, 1e-3);
+
+    offset = predicted + error * 0.1;
+    offsetTime = receiveTime;
+}
+
+double ClockSync::getOffset(double localTime) const
+{
+    return offset + drift * (localTime - offsetTime);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Wire format of the clock sync ping/pong, on NetworkManager's own channel (never seen by the game).
+// Times are seconds of the sender's steady clock.
+#pragma pack(push, 1)
+struct ClockSyncMessage
+{
+    uint8_t pong;       // 0 = ping, 1 = pong
+    uint32_t sequence;
+    double originTime;  // ping: sent at (echoed back in the pong)
+    double replyTime;   // pong: the responder's clock when it answered
+    double tickEpoch;   // pong: the responder's clock at its simulation tick 0, 0 = not running
+    float tickRate;     // pong: the responder's ticks per second
+};
+#pragma pack(pop)
+
+// Round trip and clock offset to one peer, from ping/pong timestamps (NTP style: the reply is
+// assumed to be halfway through the round trip). The offset comes from the fastest of the last
+// few exchanges, the ones least delayed by queues, and is slewed toward it instead of jumping;
+// the slow drift between the two clocks is tracked so the mapping stays right between pings.
+class ClockSync
+{
+public:
+    static constexpr size_t sampleWindow = 8;
+
+    void reset();
+
+    // a pong for a ping sent at `originTime` (local), answered at `replyTime` (remote), received at `receiveTime` (local)
+    void addSample(double originTime, double replyTime, double receiveTime);
+
+    bool hasEstimate() const { return sampleCount > 0; }
+    double getRtt() const { return smoothedRtt; }
+    double getJitter() const { return rttVariation; } // mean deviation of the round trip
+    double getOffset(double localTime) const;         // remote clock - local clock
+
+private:
+    struct Sample
+    {
+        double rtt;
+        double offset;
+    };
+    std::array<Sample, sampleWindow> samples{};
+    size_t sampleCount = 0;
+    size_t nextSample = 0;
+
+    double smoothedRtt = 0.0;
+    double rttVariation = 0.0;
+
+    double offset = 0.0;
+    double offsetTime = 0.0; // local time the offset was last updated
+    double drift = 0.0;      // seconds of offset change per second
+};
@@ -0,0 +1,67 @@
+#include "CongestionController.hpp"
+
+#include <algorithm>
+
+CongestionController::CongestionController(const CongestionSettings &settings)
+    : settings(settings), bytesPerSecond((double)settings.startBytesPerSecond)
+{
+}
+
+void CongestionController::reset()
+{
+    bytesPerSecond = (double)settings.startBytesPerSecond;
+    lastUpdate = 0.0;
+    lastDecrease = 0.0;
+    baseRoundTripTime = 0.0;
+    snapshotLoss = 0.f;
+    congested = false;
+    decreases = 0;
+}
+
+void CongestionController::update(const LinkStats &link, double now)
+{
+    const double elapsed = lastUpdate > 0.0 ? now - lastUpdate : 0.0;
+    lastUpdate = now;
+    if (link.roundTripTime == 0)
+        return; // nothing measured yet
+
+    if (baseRoundTripTime == 0.0 || link.roundTripTime < baseRoundTripTime)
+        baseRoundTripTime = link.roundTripTime;
+    else
+        baseRoundTripTime += elapsed * 2.0; // ms per second
+
+    const float loss = std::max(link.packetLoss, snapshotLoss);
+    congested = loss > settings.lossThreshold || link.roundTripTime > baseRoundTripTime + settings.queueDelayMs || link.throttle < settings.minThrottle;
+
+    if (congested)
+    {
+        // once per round trip, the effect of the last decrease has to show first
+        const double roundTrip = std::max(0.1, link.roundTripTime / 1000.0);
+        if (now - lastDecrease >= roundTrip)
+        {
+            bytesPerSecond *= settings.decreaseFactor;
+            lastDecrease = now;
+            decreases++;
+        }
+    }
+    else
+    {
+        bytesPerSecond += settings.increasePerSecond * elapsed;
+    }
+
+    bytesPerSecond = std::clamp(bytesPerSecond, (double)settings.minBytesPerSecond, (double)settings.maxBytesPerSecond);
+}
+
+void CongestionController::onSnapshotAck(size_t lost)
+{
+    for (size_t i = 0; i < lost; i++)
+        snapshotLoss += (1.f - snapshotLoss) * settings.snapshotLossGain;
+    snapshotLoss -= snapshotLoss * settings.snapshotLossGain;
+}
+
+int CongestionController::getSendRate() const
+{
+    // fewer, still useful snapshots instead of many tiny ones
+    const int rate = (int)(bytesPerSecond / (double)settings.minSnapshotBytes);
+    return std::clamp(rate, settings.minSendRate, settings.maxSendRate);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ENet's view of one peer's link, sampled by the network thread
+struct LinkStats
+{
+    uint32_t roundTripTime = 0;         // ms, ENet's smoothed value
+    uint32_t roundTripTimeVariance = 0; // ms
+    float packetLoss = 0.f;             // 0..1
+    float throttle = 1.f;               // ENet's reliable send throttle, 1 = unthrottled
+};
+
+struct CongestionSettings
+{
+    size_t minBytesPerSecond = 4 * 1024;
+    size_t maxBytesPerSecond = 64 * 1024;
+    size_t startBytesPerSecond = 24 * 1024;
+    size_t increasePerSecond = 2 * 1024; // additive, while the link looks fine
+    float decreaseFactor = 0.7f;         // multiplicative, on congestion
+    float lossThreshold = 0.02f;         // above this much packet loss, ENet's or the snapshot stream's
+    float snapshotLossGain = 1.f / 16.f; // smoothing of the snapshot loss, per snapshot
+    uint32_t queueDelayMs = 80;          // or when the round trip grew this much over the best one seen
+    float minThrottle = 0.75f;           // or when ENet throttled reliable sends below this
+
+    int minSendRate = 5;                 // snapshots per second
+    int maxSendRate = 30;
+    size_t minSnapshotBytes = 512;       // below this per snapshot, send less often instead
+};
+
+// Send rate for state replication, additive increase / multiplicative decrease (like TCP) on
+// ENet's round trip, loss and throttle statistics. Growing round trips mean queues filling up
+// somewhere (typical for congested Wi-Fi), so the rate comes down before packets get lost.
+// Decreases happen at most once per round trip, the rate recovers gradually.
+// ENet only measures loss on reliable traffic; the unreliable snapshots this controls report theirs
+// through onSnapshotAck(), from the gaps in the client's acknowledgements.
+class CongestionController
+{
+public:
+    explicit CongestionController(const CongestionSettings &settings = CongestionSettings{});
+
+    void reset();
+    void update(const LinkStats &link, double now);
+    void onSnapshotAck(size_t lost); // a snapshot was acknowledged, `lost` sent before it never were
+
+    size_t getBytesPerSecond() const { return (size_t)bytesPerSecond; }
+    int getSendRate() const; // snapshots per second for the current byte rate
+    bool isCongested() const { return congested; }
+    float getSnapshotLoss() const { return snapshotLoss; }
+    uint32_t getBaseRoundTripTime() const { return (uint32_t)baseRoundTripTime; }
+    size_t getDecreases() const { return decreases; }
+
+private:
+    CongestionSettings settings;
+
+    double bytesPerSecond;
+    double lastUpdate = 0.0;
+    double lastDecrease = 0.0;
+    double baseRoundTripTime = 0.0; // ms, lowest seen; rises slowly so a changed route is picked up
+    float snapshotLoss = 0.f;       // 0..1, smoothed over the last snapshots
+    bool congested = false;
+    size_t decreases = 0;
+};
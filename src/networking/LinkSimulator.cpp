@@ -0,0 +1,157 @@
+#include "LinkSimulator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    bool later(const auto &a, const auto &b)
+    {
+        return a.due != b.due ? a.due > b.due : a.order > b.order;
+    }
+}
+
+bool LinkConditions::parse(const std::string &text, LinkConditions &out)
+{
+    LinkConditions conditions;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        const std::string item = text.substr(start, end - start);
+        start = end + 1;
+        if (item.empty())
+            continue;
+
+        const size_t equals = item.find('=');
+        if (equals == std::string::npos)
+            return false;
+        const std::string key = item.substr(0, equals);
+        const std::string value = item.substr(equals + 1);
+
+        char *parsedEnd = nullptr;
+        const double number = std::strtod(value.c_str(), &parsedEnd);
+        if (value.empty() || *parsedEnd != '\0' || number < 0.0)
+            return false;
+
+        if (key == "latency")
+            conditions.latencyMs = (float)number;
+        else if (key == "jitter")
+            conditions.jitterMs = (float)number;
+        else if (key == "loss")
+            conditions.loss = (float)number;
+        else if (key == "duplicate")
+            conditions.duplicate = (float)number;
+        else if (key == "reorder")
+            conditions.reorder = (float)number;
+        else if (key == "reorderDelay")
+            conditions.reorderMs = (float)number;
+        else if (key == "seed")
+            conditions.seed = (uint32_t)number;
+        else
+            return false;
+    }
+
+    out = conditions;
+    return true;
+}
+
+LinkSimulator::LinkSimulator(const LinkConditions &conditions)
+{
+    reset(conditions);
+}
+
+void LinkSimulator::reset(const LinkConditions &newConditions)
+{
+    conditions = newConditions;
+    rng.seed(conditions.seed);
+    for (Datagram &datagram : queue)
+        spare.push_back(std::move(datagram.data));
+    queue.clear();
+    lastInOrderDue = 0.0;
+    nextOrder = 0;
+    stats = Stats{};
+}
+
+float LinkSimulator::uniform()
+{
+    return (float)(rng() >> 8) * (1.f / 16777216.f); // 24 bits, exact in a float
+}
+
+void LinkSimulator::submit(double now, const uint8_t *data, size_t size)
+{
+    stats.submitted++;
+
+    // fixed draws per datagram, see the class comment
+    const float lossRoll = uniform();
+    const float duplicateRoll = uniform();
+    const float reorderRoll = uniform();
+    const float jitterRoll = uniform() * 2.f - 1.f;
+    const float duplicateDelayRoll = uniform();
+
+    if (lossRoll < conditions.loss)
+    {
+        stats.dropped++;
+        return;
+    }
+
+    double due = now + (conditions.latencyMs + jitterRoll * conditions.jitterMs) / 1000.0;
+    if (reorderRoll < conditions.reorder)
+    {
+        due += conditions.reorderMs / 1000.0;
+        stats.reordered++;
+    }
+    else
+    {
+        // jitter alone does not overtake, like a queue on the path
+        due = std::max(due, lastInOrderDue);
+        lastInOrderDue = due;
+    }
+    schedule(due, data, size);
+
+    if (duplicateRoll < conditions.duplicate)
+    {
+        schedule(due + duplicateDelayRoll * conditions.jitterMs / 1000.0, data, size);
+        stats.duplicated++;
+    }
+}
+
+void LinkSimulator::schedule(double due, const uint8_t *data, size_t size)
+{
+    std::vector<uint8_t> buffer;
+    if (!spare.empty())
+    {
+        buffer = std::move(spare.back());
+        spare.pop_back();
+    }
+    buffer.assign(data, data + size);
+
+    queue.push_back(Datagram{due, nextOrder++, std::move(buffer)});
+    std::push_heap(queue.begin(), queue.end(), [](const Datagram &a, const Datagram &b)
+                   { return later(a, b); });
+}
+
+bool LinkSimulator::poll(double now, std::vector<uint8_t> &out)
+{
+    if (queue.empty() || queue.front().due > now)
+        return false;
+
+    std::pop_heap(queue.begin(), queue.end(), [](const Datagram &a, const Datagram &b)
+                  { return later(a, b); });
+    out.swap(queue.back().data);
+    spare.push_back(std::move(queue.back().data));
+    queue.pop_back();
+
+    stats.delivered++;
+    stats.bytesDelivered += out.size();
+    return true;
+}
+
+double LinkSimulator::nextDue() const
+{
+    return queue.empty() ? -1.0 : queue.front().due;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Impairments of one direction of a link
+struct LinkConditions
+{
+    float latencyMs = 0.f;  // one way
+    float jitterMs = 0.f;   // +- uniform; datagrams still arrive in the order sent unless reordered
+    float loss = 0.f;       // 0..1
+    float duplicate = 0.f;  // 0..1, the copy arrives up to one jitter later
+    float reorder = 0.f;    // 0..1, held back behind the datagrams sent after it
+    float reorderMs = 20.f; // by this much
+    uint32_t seed = 1;
+
+    // "latency=80,jitter=20,loss=0.02,duplicate=0.01,reorder=0.01,seed=7"; false on unknown keys or bad numbers
+    static bool parse(const std::string &text, LinkConditions &out);
+};
+
+// Decides the fate of every datagram sent in one direction: dropped, delayed, duplicated or reordered.
+// Deterministic: the same seed and the same sequence of submit() calls give the same fates, however
+// the calls are timed; every datagram draws the same amount of random numbers whatever happens to it,
+// and the numbers do not go through the standard distributions (their output differs between libraries).
+class LinkSimulator
+{
+public:
+    struct Stats
+    {
+        size_t submitted = 0;
+        size_t delivered = 0;
+        size_t dropped = 0;
+        size_t duplicated = 0;
+        size_t reordered = 0;
+        size_t bytesDelivered = 0;
+    };
+
+    explicit LinkSimulator(const LinkConditions &conditions = LinkConditions{});
+
+    void reset(const LinkConditions &conditions);
+
+    // `now` in seconds, any monotonic clock as long as poll() uses the same one
+    void submit(double now, const uint8_t *data, size_t size);
+
+    // the next datagram due by `now` into `out` (resized), false when none is
+    bool poll(double now, std::vector<uint8_t> &out);
+
+    double nextDue() const; // when poll() has something next, a negative value when nothing is queued
+    size_t getQueued() const { return queue.size(); }
+    const Stats &getStats() const { return stats; }
+
+private:
+    struct Datagram
+    {
+        double due;
+        uint64_t order; // ties keep the submit order
+        std::vector<uint8_t> data;
+    };
+
+    float uniform(); // [0, 1)
+    void schedule(double due, const uint8_t *data, size_t size);
+
+    LinkConditions conditions;
+    std::mt19937 rng;
+
+    std::vector<Datagram> queue; // min-heap on (due, order)
+    std::vector<std::vector<uint8_t>> spare; // payload buffers of delivered datagrams, reused
+    double lastInOrderDue = 0.0;
+    uint64_t nextOrder = 0;
+    Stats stats;
+};
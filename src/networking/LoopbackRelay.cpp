@@ -0,0 +1,225 @@
+#include "LoopbackRelay.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr size_t maxDatagramSize = 4096; // ENet stays below its MTU
+
+    void addStats(LinkSimulator::Stats &sum, const LinkSimulator::Stats &stats)
+    {
+        sum.submitted += stats.submitted;
+        sum.delivered += stats.delivered;
+        sum.dropped += stats.dropped;
+        sum.duplicated += stats.duplicated;
+        sum.reordered += stats.reordered;
+        sum.bytesDelivered += stats.bytesDelivered;
+    }
+
+    void sendDatagram(ENetSocket socket, const ENetAddress &to, std::vector<uint8_t> &data)
+    {
+        ENetBuffer buffer;
+        buffer.data = data.data();
+        buffer.dataLength = data.size();
+        enet_socket_send(socket, &to, &buffer, 1);
+    }
+}
+
+LoopbackRelay::~LoopbackRelay()
+{
+    stop();
+}
+
+double LoopbackRelay::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool LoopbackRelay::start(enet_uint16 listenPort, const ENetAddress &server, const LinkConditions &toServer, const LinkConditions &toClient)
+{
+    stop();
+
+    listenSocket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    if (listenSocket == ENET_SOCKET_NULL)
+    {
+        std::cerr << "Relay socket creation failed!\n";
+        return false;
+    }
+
+    ENetAddress address{};
+    enet_address_set_host_ip(&address, "127.0.0.1");
+    address.port = listenPort;
+    if (enet_socket_bind(listenSocket, &address) < 0)
+    {
+        std::cerr << "Relay could not bind port " << listenPort << "\n";
+        enet_socket_destroy(listenSocket);
+        listenSocket = ENET_SOCKET_NULL;
+        return false;
+    }
+    enet_socket_set_option(listenSocket, ENET_SOCKOPT_NONBLOCK, 1);
+
+    serverAddress = server;
+    toServerConditions = toServer;
+    toClientConditions = toClient;
+    datagram.resize(maxDatagramSize);
+    std::cout << "Link simulation relay on port " << listenPort << " -> " << server.port << "\n";
+    return true;
+}
+
+void LoopbackRelay::stop()
+{
+    threadRunning = false;
+    if (thread.joinable())
+        thread.join();
+
+    for (const std::unique_ptr<Session> &session : sessions)
+        enet_socket_destroy(session->upstream);
+    sessions.clear();
+
+    if (listenSocket != ENET_SOCKET_NULL)
+    {
+        enet_socket_destroy(listenSocket);
+        listenSocket = ENET_SOCKET_NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    publishedStats = Stats{};
+}
+
+void LoopbackRelay::startThread()
+{
+    if (!isRunning() || threadRunning)
+        return;
+
+    threadRunning = true;
+    thread = std::thread([this]()
+                         {
+                             while (threadRunning)
+                                 service(1); });
+}
+
+LoopbackRelay::Session *LoopbackRelay::findSession(const ENetAddress &client)
+{
+    for (const std::unique_ptr<Session> &session : sessions)
+        if (session->client.host == client.host && session->client.port == client.port)
+            return session.get();
+
+    ENetSocket upstream = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    if (upstream == ENET_SOCKET_NULL)
+        return nullptr;
+
+    ENetAddress local{};
+    enet_address_set_host_ip(&local, "127.0.0.1");
+    local.port = ENET_PORT_ANY;
+    if (enet_socket_bind(upstream, &local) < 0)
+    {
+        enet_socket_destroy(upstream);
+        return nullptr;
+    }
+    enet_socket_set_option(upstream, ENET_SOCKOPT_NONBLOCK, 1);
+
+    // distinct but reproducible random streams per session and direction
+    LinkConditions toServer = toServerConditions;
+    LinkConditions toClient = toClientConditions;
+    toServer.seed = toServerConditions.seed * 2654435761u + (uint32_t)sessions.size() * 2;
+    toClient.seed = toClientConditions.seed * 2654435761u + (uint32_t)sessions.size() * 2 + 1;
+
+    sessions.push_back(std::make_unique<Session>(Session{client, upstream, LinkSimulator(toServer), LinkSimulator(toClient)}));
+    return sessions.back().get();
+}
+
+void LoopbackRelay::receiveFrom(ENetSocket socket, Session *session)
+{
+    const double received = now();
+    for (;;)
+    {
+        ENetAddress from{};
+        ENetBuffer buffer;
+        buffer.data = datagram.data();
+        buffer.dataLength = datagram.size();
+        const int size = enet_socket_receive(socket, &from, &buffer, 1);
+        if (size <= 0)
+            return;
+
+        if (session) // from the server, back to this session's client
+        {
+            session->toClient.submit(received, datagram.data(), (size_t)size);
+            continue;
+        }
+
+        if (Session *client = findSession(from))
+            client->toServer.submit(received, datagram.data(), (size_t)size);
+    }
+}
+
+void LoopbackRelay::service(enet_uint32 timeoutMs)
+{
+    if (!isRunning())
+        return;
+
+    // wait for datagrams, but not past the next one that is due
+    double wake = now() + timeoutMs / 1000.0;
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        const double toServer = session->toServer.nextDue();
+        const double toClient = session->toClient.nextDue();
+        if (toServer >= 0.0 && toServer < wake)
+            wake = toServer;
+        if (toClient >= 0.0 && toClient < wake)
+            wake = toClient;
+    }
+    const double wait = wake - now();
+    const enet_uint32 waitMs = wait > 0.0 ? (enet_uint32)(wait * 1000.0) : 0;
+
+    ENetSocketSet readSet;
+    ENET_SOCKETSET_EMPTY(readSet);
+    ENET_SOCKETSET_ADD(readSet, listenSocket);
+    ENetSocket maxSocket = listenSocket;
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        ENET_SOCKETSET_ADD(readSet, session->upstream);
+        if (session->upstream > maxSocket)
+            maxSocket = session->upstream;
+    }
+
+    if (enet_socketset_select(maxSocket, &readSet, nullptr, waitMs) > 0)
+    {
+        receiveFrom(listenSocket, nullptr);
+        for (const std::unique_ptr<Session> &session : sessions)
+            receiveFrom(session->upstream, session.get());
+    }
+
+    const double due = now();
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        while (session->toServer.poll(due, datagram))
+            sendDatagram(session->upstream, serverAddress, datagram);
+        while (session->toClient.poll(due, datagram))
+            sendDatagram(listenSocket, session->client, datagram);
+    }
+    datagram.resize(maxDatagramSize); // poll() swapped in payload buffers
+
+    publishStats();
+}
+
+void LoopbackRelay::publishStats()
+{
+    Stats stats;
+    stats.sessions = sessions.size();
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        addStats(stats.toServer, session->toServer.getStats());
+        addStats(stats.toClients, session->toClient.getStats());
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    publishedStats = stats;
+}
+
+LoopbackRelay::Stats LoopbackRelay::getStats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return publishedStats;
+}
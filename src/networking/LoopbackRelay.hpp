@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <enet/enet.h>
+
+#include "LinkSimulator.hpp"
+
+// UDP relay on localhost that runs ENet traffic through a LinkSimulator per direction, so two
+// NetworkManagers in one process (or two processes on one machine) talk over a bad network.
+// Clients connect to the relay's port instead of the server's; every client address gets its own
+// socket toward the server, so the server still sees separate peers. Each session's simulators are
+// seeded from the conditions' seed and the session's index.
+class LoopbackRelay
+{
+public:
+    struct Stats
+    {
+        LinkSimulator::Stats toServer; // summed over all sessions
+        LinkSimulator::Stats toClients;
+        size_t sessions = 0;
+    };
+
+    LoopbackRelay() = default;
+    ~LoopbackRelay();
+
+    LoopbackRelay(const LoopbackRelay &) = delete;
+    LoopbackRelay &operator=(const LoopbackRelay &) = delete;
+
+    // listens on 127.0.0.1:listenPort, forwards to `server`
+    bool start(enet_uint16 listenPort, const ENetAddress &server, const LinkConditions &toServer, const LinkConditions &toClient);
+    void stop();
+
+    // runs service() on a thread of its own until stop()
+    void startThread();
+
+    // forwards what arrived and what is due, waits at most timeoutMs for more; one thread at a time
+    void service(enet_uint32 timeoutMs);
+
+    bool isRunning() const { return listenSocket != ENET_SOCKET_NULL; }
+    Stats getStats() const; // any thread
+
+private:
+    struct Session
+    {
+        ENetAddress client;
+        ENetSocket upstream; // toward the server, bound to an ephemeral local port
+        LinkSimulator toServer;
+        LinkSimulator toClient;
+    };
+
+    static double now();
+    Session *findSession(const ENetAddress &client);
+    void receiveFrom(ENetSocket socket, Session *session);
+    void publishStats();
+
+    ENetSocket listenSocket = ENET_SOCKET_NULL;
+    ENetAddress serverAddress{};
+    LinkConditions toServerConditions;
+    LinkConditions toClientConditions;
+
+    std::vector<std::unique_ptr<Session>> sessions; // stable addresses, owned by the servicing thread
+    std::vector<uint8_t> datagram;
+
+    std::thread thread;
+    std::atomic<bool> threadRunning{false};
+
+    // copy of the per-session stats for other threads
+    mutable std::mutex statsMutex;
+    Stats publishedStats;
+};
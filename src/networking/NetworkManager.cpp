@@ -8,6 +8,27 @@ NetworkManager::NetworkManager()
     if (enet_initialize() != 0)
     {
         std::cerr << "ENet initialization failed!\n";
+        return;
+    }
+
+    // bound to an ephemeral loopback port, wake() sends a byte to itself
+    wakeSocket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    if (wakeSocket != ENET_SOCKET_NULL)
+    {
+        ENetAddress address{};
+        enet_address_set_host_ip(&address, "127.0.0.1");
+        address.port = ENET_PORT_ANY;
+
+        if (enet_socket_bind(wakeSocket, &address) < 0 || enet_socket_get_address(wakeSocket, &wakeAddress) < 0)
+        {
+            std::cerr << "Network wake socket setup failed, falling back to timeouts\n";
+            enet_socket_destroy(wakeSocket);
+            wakeSocket = ENET_SOCKET_NULL;
+        }
+        else
+        {
+            enet_socket_set_option(wakeSocket, ENET_SOCKOPT_NONBLOCK, 1);
+        }
     }
 }
 
@@ -15,6 +36,8 @@ NetworkManager::~NetworkManager()
 {
     stopServerDiscoveryAsync();
     shutdown();
+    if (wakeSocket != ENET_SOCKET_NULL)
+        enet_socket_destroy(wakeSocket);
     enet_deinitialize();
 }
 
@@ -78,7 +101,7 @@ bool NetworkManager::startServer(enet_uint16 port)
     address.host = ENET_HOST_ANY;
     address.port = port;
 
-    host = enet_host_create(&address, 32, 2, 0, 0); // max 32 clients, 2 channels
+    host = enet_host_create(&address, 32, channelCount, 0, 0); // max 32 clients
     if (!host)
     {
         std::cerr << "Failed to create ENet server host!\n";
@@ -86,14 +109,30 @@ bool NetworkManager::startServer(enet_uint16 port)
     }
 
     isServer = true;
+    serverPort = port;
     connected = false;
     std::cout << "Server started on port " << port << "\n";
     return true;
 }
 
+bool NetworkManager::startLinkSimulation(enet_uint16 relayPort, const LinkConditions &toServer, const LinkConditions &toClient)
+{
+    if (!host || !isServer)
+        return false;
+
+    ENetAddress server{};
+    enet_address_set_host_ip(&server, "127.0.0.1");
+    server.port = serverPort;
+    if (!relay.start(relayPort, server, toServer, toClient))
+        return false;
+
+    relay.startThread();
+    return true;
+}
+
 bool NetworkManager::startClient(const std::string &hostIP, enet_uint16 port)
 {
-    host = enet_host_create(nullptr, 1, 2, 0, 0); // client, 1 peer
+    host = enet_host_create(nullptr, 1, channelCount, 0, 0); // client, 1 peer
     if (!host)
     {
         std::cerr << "Failed to create ENet client host!\n";
@@ -104,7 +143,7 @@ bool NetworkManager::startClient(const std::string &hostIP, enet_uint16 port)
     enet_address_set_host(&address, hostIP.c_str());
     address.port = port;
 
-    peer = enet_host_connect(host, &address, 2, 0);
+    peer = enet_host_connect(host, &address, channelCount, 0);
     if (!peer)
     {
         std::cerr << "Failed to connect to server!\n";
@@ -113,6 +152,7 @@ bool NetworkManager::startClient(const std::string &hostIP, enet_uint16 port)
 
     isServer = false;
     connected = false;
+    connectionLost = false;
     std::cout << "Connecting to server " << hostIP << ":" << port << "\n";
     return true;
 }
@@ -122,99 +162,462 @@ bool NetworkManager::isConnected() const
     return connected.load();
 }
 
-void NetworkManager::send(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags)
+void NetworkManager::sendBytes(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags, Recipients to)
+{
+    if (!data || size == 0 || !host)
+        return;
+
+    uint8_t *buffer = size <= PacketPool::bufferSize ? sendPool.acquire() : nullptr;
+    if (!buffer)
+    {
+        // oversized or pool exhausted: let ENet copy
+        dispatch(enet_packet_create(data, size, flags), channel, to);
+        return;
+    }
+
+    std::memcpy(buffer, data, size);
+    sendBuffer(buffer, size, channel, flags, to);
+}
+
+void NetworkManager::sendBuffer(uint8_t *buffer, size_t size, enet_uint8 channel, enet_uint32 flags, Recipients to)
 {
-    if (!data || size == 0)
+    if (!buffer)
+        return;
+
+    if (!host || size == 0 || size > PacketPool::bufferSize)
+    {
+        sendPool.release(buffer);
+        return;
+    }
+
+    dispatch(sendPool.wrap(buffer, size, flags), channel, to);
+}
+
+void NetworkManager::dispatch(ENetPacket *packet, enet_uint8 channel, Recipients to)
+{
+    if (!packet)
         return;
 
     if (isServer)
-        SendToClient(data, size, channel, flags);
+        SendToClient(packet, channel, to);
     else
-        SendToServer(data, size, channel, flags);
+        SendToServer(packet, channel);
+
+    // no peer took a reference (nobody connected): nothing else will ever free it
+    if (packet->referenceCount == 0)
+        enet_packet_destroy(packet);
 }
 
-void NetworkManager::SendToServer(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags)
+void NetworkManager::SendToServer(ENetPacket *packet, enet_uint8 channel)
 {
     if (!peer || !host)
         return;
 
-    ENetPacket *packet = enet_packet_create(data, size, flags);
-    enet_peer_send(peer, channel, packet);
-    enet_host_flush(host);
+    if (enet_peer_send(peer, channel, packet) == 0)
+        countSent(peer, packet, channel);
 }
 
-void NetworkManager::SendToClient(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags)
+void NetworkManager::SendToClient(ENetPacket *packet, enet_uint8 channel, Recipients to)
 {
     if (!isServer || !host)
         return;
 
-    for (size_t i = 0; i < host->peerCount; ++i)
+    if (to == Recipients::Player)
+    {
+        if (playerPeer && enet_peer_send(playerPeer, channel, packet) == 0)
+            countSent(playerPeer, packet, channel);
+        return;
+    }
+
+    // the same packet is queued on every recipient, ENet frees it after the last one is done
+    for (size_t i = 0; i < host->peerCount && i < maxPeers; ++i)
     {
         ENetPeer *clientPeer = &host->peers[i];
-        if (clientPeer->state == ENET_PEER_STATE_CONNECTED)
+        const PeerRole role = peerRoles[i];
+        if (clientPeer->state != ENET_PEER_STATE_CONNECTED || role == PeerRole::None)
+            continue;
+        if (to == Recipients::Spectators && role == PeerRole::Player)
+            continue;
+        if (to == Recipients::JoiningSpectators && role != PeerRole::JoiningSpectator)
+            continue;
+
+        if (enet_peer_send(clientPeer, channel, packet) == 0)
+            countSent(clientPeer, packet, channel);
+
+        // everything after the join snapshot builds on it
+        if (to == Recipients::JoiningSpectators)
         {
-            ENetPacket *packet = enet_packet_create(data, size, flags);
-            enet_peer_send(clientPeer, channel, packet);
+            peerRoles[i] = PeerRole::Spectator;
+            joiningSpectatorCount.fetch_sub(1, std::memory_order_relaxed);
         }
     }
-    enet_host_flush(host);
 }
 
-std::optional<std::vector<uint8_t>> NetworkManager::pollEvent()
+void NetworkManager::addPeer(ENetPeer *p)
+{
+    const size_t index = peerIndex(p);
+    if (index >= maxPeers)
+        return;
+
+    if (!playerPeer)
+    {
+        peerRoles[index] = PeerRole::Player;
+        playerPeer = p;
+        std::cout << "Client connected!\n";
+        return;
+    }
+
+    peerRoles[index] = PeerRole::JoiningSpectator;
+    spectatorCount.fetch_add(1, std::memory_order_relaxed);
+    joiningSpectatorCount.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "Spectator connected (" << spectatorCount.load(std::memory_order_relaxed) << " watching)\n";
+}
+
+void NetworkManager::removePeer(ENetPeer *p)
+{
+    const size_t index = peerIndex(p);
+    if (index >= maxPeers)
+        return;
+
+    const PeerRole role = peerRoles[index];
+    peerRoles[index] = PeerRole::None;
+    if (role == PeerRole::None)
+        return; // never got connected
+    if (role == PeerRole::Player)
+    {
+        playerPeer = nullptr;
+        std::cout << "Peer disconnected.\n";
+        return;
+    }
+
+    if (role == PeerRole::JoiningSpectator)
+        joiningSpectatorCount.fetch_sub(1, std::memory_order_relaxed);
+    spectatorCount.fetch_sub(1, std::memory_order_relaxed);
+    std::cout << "Spectator disconnected.\n";
+}
+
+void NetworkManager::resetPeers()
+{
+    peerRoles.fill(PeerRole::None);
+    playerPeer = nullptr;
+    spectatorCount = 0;
+    joiningSpectatorCount = 0;
+}
+
+void NetworkManager::flush()
+{
+    if (host)
+        enet_host_flush(host);
+}
+
+void NetworkManager::waitForActivity(enet_uint32 timeoutMs)
+{
+    ENetSocketSet readSet;
+    ENET_SOCKETSET_EMPTY(readSet);
+
+    ENetSocket maxSocket = 0;
+    if (host)
+    {
+        ENET_SOCKETSET_ADD(readSet, host->socket);
+        maxSocket = host->socket;
+    }
+    if (wakeSocket != ENET_SOCKET_NULL)
+    {
+        ENET_SOCKETSET_ADD(readSet, wakeSocket);
+        if (wakeSocket > maxSocket)
+            maxSocket = wakeSocket;
+    }
+
+    if (!host && wakeSocket == ENET_SOCKET_NULL)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+
+    if (enet_socketset_select(maxSocket, &readSet, nullptr, timeoutMs) <= 0)
+        return; // timeout (or interrupted), the caller services the host anyway
+
+    // several wake() calls may have piled up, one wait consumes all of them
+    if (wakeSocket != ENET_SOCKET_NULL && ENET_SOCKETSET_CHECK(readSet, wakeSocket))
+    {
+        uint8_t scratch[16];
+        ENetBuffer buffer{scratch, sizeof(scratch)};
+        ENetAddress from;
+        while (enet_socket_receive(wakeSocket, &from, &buffer, 1) > 0)
+        {
+        }
+    }
+}
+
+void NetworkManager::wake()
+{
+    if (wakeSocket == ENET_SOCKET_NULL)
+        return;
+
+    uint8_t signal = 1;
+    ENetBuffer buffer{&signal, 1};
+    enet_socket_send(wakeSocket, &wakeAddress, &buffer, 1);
+}
+
+void NetworkManager::service()
 {
     if (!host)
-        return std::nullopt;
+        return;
 
+    // back-pressure: only take events from ENet while a received packet has somewhere to go
     ENetEvent event;
-    while (enet_host_service(host, &event, 0) > 0)
+    while (packetQueue.size() < packetQueue.capacity())
     {
+        if (enet_host_service(host, &event, 0) <= 0)
+            break;
+
         switch (event.type)
         {
         case ENET_EVENT_TYPE_CONNECT:
-            std::cout << (isServer ? "Client connected!" : "Connected to server!") << "\n";
-            if (!isServer)
+            if (isServer)
+            {
+                addPeer(event.peer);
+                if (event.peer != playerPeer)
+                    break; // spectators neither sync clocks nor count as connected
+            }
+            else
+            {
+                std::cout << "Connected to server!\n";
                 peer = event.peer;
+            }
+            if (!clockPeer)
+            {
+                resetClockSync();
+                clockPeer = event.peer;
+            }
+            connections++;
             connected = true;
             break;
         case ENET_EVENT_TYPE_RECEIVE:
-            // Copy the bytes before destroying the ENetPacket.
-            PushPacket(event.packet->data, event.packet->dataLength);
-            enet_packet_destroy(event.packet);
+            stats.countReceived(event.channelID, event.packet->dataLength);
+            if (event.channelID == clockSyncChannel)
+            {
+                handleClockSync(event.peer, event.packet, clockNow());
+                enet_packet_destroy(event.packet);
+                break;
+            }
+            // spectators are read-only
+            if (isServer && event.peer != playerPeer)
+            {
+                enet_packet_destroy(event.packet);
+                break;
+            }
+            // ownership moves on to the consumer, no copy; there is room, checked above
+            packetQueue.push(event.packet);
             break;
         case ENET_EVENT_TYPE_DISCONNECT:
-            std::cout << "Peer disconnected.\n";
+            if (isServer)
+            {
+                const bool wasPlayer = event.peer == playerPeer;
+                removePeer(event.peer);
+                if (!wasPlayer)
+                    break;
+            }
+            else
+            {
+                std::cout << "Peer disconnected.\n";
+                connectionLost = true;
+            }
+            if (event.peer == clockPeer)
+                clockPeer = nullptr;
             connected = false;
             break;
         default:
             break;
         }
     }
+    if (packetQueue.size() == packetQueue.capacity())
+    {
+        // the rest stays queued in ENet (and the socket); acks and resends still go out
+        receiveStalls.fetch_add(1, std::memory_order_relaxed);
+        enet_host_flush(host);
+    }
+
+    const double now = clockNow();
+    if (clockPeer && now - lastPingTime >= pingInterval)
+        sendPing(now);
+    updateSendRates(now);
 
-    std::lock_guard<std::mutex> lock(queueMutex);
-    if (!packetQueue.empty())
+    if (clockPeer)
     {
-        std::vector<uint8_t> packet = std::move(packetQueue.front());
-        packetQueue.pop();
-        return packet;
+        linkRoundTripTime.store(clockPeer->roundTripTime, std::memory_order_relaxed);
+        linkRoundTripTimeVariance.store(clockPeer->roundTripTimeVariance, std::memory_order_relaxed);
+        linkPacketLoss.store((float)clockPeer->packetLoss / ENET_PEER_PACKET_LOSS_SCALE, std::memory_order_relaxed);
+        linkThrottle.store((float)clockPeer->packetThrottle / ENET_PEER_PACKET_THROTTLE_SCALE, std::memory_order_relaxed);
     }
-    return std::nullopt;
+    updateStats(now);
+}
+
+void NetworkManager::countSent(const ENetPeer *to, const ENetPacket *packet, enet_uint8 channel)
+{
+    stats.countSent(channel, packet->dataLength);
+
+    const size_t index = isServer ? (size_t)(to - host->peers) : 0;
+    if (index < maxPeers)
+        peerBytesSent[index] += packet->dataLength;
 }
 
-void NetworkManager::PushPacket(const void *data, size_t size)
+void NetworkManager::sampleQueues(size_t incoming, size_t outgoing, size_t incomingStalls)
 {
-    std::lock_guard<std::mutex> lock(queueMutex);
-    const uint8_t *bytes = static_cast<const uint8_t *>(data);
-    packetQueue.emplace(bytes, bytes + size);
+    stats.sampleQueues(packetQueue.size(), incoming, outgoing);
+    stats.setReceiveStalls(receiveStalls.load(std::memory_order_relaxed) + incomingStalls);
+}
+
+void NetworkManager::updateStats(double now)
+{
+    uint32_t peers = 0;
+    for (size_t i = 0; i < host->peerCount && i < maxPeers; i++)
+    {
+        const ENetPeer &p = host->peers[i];
+        if (p.state != ENET_PEER_STATE_CONNECTED)
+            continue;
+        peers++;
+        stats.sampleRetransmits(i, p.packetsLost);
+    }
+
+    stats.publish(now, host->totalSentData, host->totalReceivedData, peers, rtt.load(std::memory_order_relaxed), rttJitter.load(std::memory_order_relaxed),
+                  linkRoundTripTime.load(std::memory_order_relaxed), linkPacketLoss.load(std::memory_order_relaxed));
+}
+
+void NetworkManager::updateSendRates(double now)
+{
+    const double elapsed = now - sendRateWindowStart;
+    if (elapsed < 1.0)
+        return;
+
+    for (size_t i = 0; i < maxPeers; i++)
+    {
+        peerSendRates[i].store(sendRateWindowStart > 0.0 ? (uint32_t)(peerBytesSent[i] / elapsed) : 0, std::memory_order_relaxed);
+        peerBytesSent[i] = 0;
+    }
+    sendRateWindowStart = now;
+}
+
+double NetworkManager::clockNow()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void NetworkManager::setLocalTickClock(double tickEpoch, float tickRate)
+{
+    localTickEpoch.store(tickEpoch, std::memory_order_relaxed);
+    localTickRate.store(tickRate, std::memory_order_relaxed);
+}
+
+LinkStats NetworkManager::getLinkStats() const
+{
+    LinkStats link;
+    link.roundTripTime = linkRoundTripTime.load(std::memory_order_relaxed);
+    link.roundTripTimeVariance = linkRoundTripTimeVariance.load(std::memory_order_relaxed);
+    link.packetLoss = linkPacketLoss.load(std::memory_order_relaxed);
+    link.throttle = linkThrottle.load(std::memory_order_relaxed);
+    return link;
+}
+
+bool NetworkManager::getRemoteTickClock(double &tickEpoch, float &tickRate) const
+{
+    tickRate = remoteTickRate.load(std::memory_order_relaxed);
+    tickEpoch = remoteTickEpoch.load(std::memory_order_relaxed);
+    return tickRate > 0.f;
+}
+
+void NetworkManager::resetClockSync()
+{
+    clockSync.reset();
+    clockPeer = nullptr;
+    lastPongSequence = pingSequence;
+    lastPingTime = 0.0;
+    rtt = 0.0;
+    rttJitter = 0.0;
+    clockOffset = 0.0;
+    remoteTickEpoch = 0.0;
+    remoteTickRate = 0.f;
+    linkRoundTripTime = 0;
+    linkRoundTripTimeVariance = 0;
+    linkPacketLoss = 0.f;
+    linkThrottle = 1.f;
+}
+
+void NetworkManager::sendPing(double now)
+{
+    ClockSyncMessage ping{};
+    ping.pong = 0;
+    ping.sequence = ++pingSequence;
+    ping.originTime = now;
+
+    ENetPacket *packet = enet_packet_create(&ping, sizeof(ping), 0); // unreliable, a resent ping measures nothing
+    if (enet_peer_send(clockPeer, clockSyncChannel, packet) < 0)
+        enet_packet_destroy(packet);
+    else
+        stats.countSent(clockSyncChannel, sizeof(ping));
+    enet_host_flush(host); // the timestamp is only good if it leaves now
+    lastPingTime = now;
+}
+
+void NetworkManager::handleClockSync(ENetPeer *from, const ENetPacket *packet, double now)
+{
+    ClockSyncMessage message{};
+    if (packet->dataLength < sizeof(message))
+        return;
+    std::memcpy(&message, packet->data, sizeof(message));
+
+    if (!message.pong)
+    {
+        // answered right away, whoever asks
+        ClockSyncMessage pong = message;
+        pong.pong = 1;
+        pong.replyTime = now;
+        pong.tickEpoch = localTickEpoch.load(std::memory_order_relaxed);
+        pong.tickRate = localTickRate.load(std::memory_order_relaxed);
+
+        ENetPacket *reply = enet_packet_create(&pong, sizeof(pong), 0);
+        if (enet_peer_send(from, clockSyncChannel, reply) < 0)
+            enet_packet_destroy(reply);
+        else
+            stats.countSent(clockSyncChannel, sizeof(pong));
+        enet_host_flush(host);
+        return;
+    }
+
+    if (from != clockPeer || message.sequence <= lastPongSequence || message.sequence > pingSequence)
+        return; // not ours, reordered or not a ping we sent
+    lastPongSequence = message.sequence;
+
+    clockSync.addSample(message.originTime, message.replyTime, now);
+
+    const double offset = clockSync.getOffset(now);
+    rtt.store(clockSync.getRtt(), std::memory_order_relaxed);
+    rttJitter.store(clockSync.getJitter(), std::memory_order_relaxed);
+    clockOffset.store(offset, std::memory_order_relaxed);
+    if (message.tickEpoch != 0.0 && message.tickRate > 0.f)
+    {
+        remoteTickEpoch.store(message.tickEpoch - offset, std::memory_order_relaxed);
+        remoteTickRate.store(message.tickRate, std::memory_order_relaxed);
+    }
 }
 
 void NetworkManager::shutdown()
 {
+    ENetPacket *pending = nullptr;
+    while (packetQueue.pop(pending))
+        enet_packet_destroy(pending);
+
+    relay.stop();
+
     if (host)
     {
         enet_host_destroy(host);
         host = nullptr;
         peer = nullptr;
     }
+    stats.reset(); // the next host counts from zero
 
     connected = false;
+    resetClockSync();
+    resetPeers();
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <string>
 #include <optional>
 #include <queue>
@@ -11,6 +12,12 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include "../utils/SpscQueue.hpp"
+#include "PacketPool.hpp"
+#include "ClockSync.hpp"
+#include "CongestionController.hpp"
+#include "LoopbackRelay.hpp"
+#include "NetworkStats.hpp"
 #ifdef _WIN32
 #include <winsock2.h>
 #else
@@ -20,9 +27,33 @@
 #include <unistd.h>
 #endif
 
+// who a server's packet goes to; a client always sends to the server.
+// The first client to connect plays, everyone connecting while it is there watches read-only.
+enum class Recipients : uint8_t
+{
+    All,
+    Player,
+    Spectators,       // every connected spectator, including those waiting for their join snapshot
+    JoiningSpectators // spectators that connected since the last join snapshot; sending one admits them
+};
+
+// encoded message waiting for the network thread, filled in place by the game thread
+struct OutgoingMessage
+{
+    enet_uint8 channel;
+    enet_uint32 flags;
+    Recipients recipients;
+    uint32_t size;
+    uint8_t data[PacketPool::bufferSize];
+};
+
 class NetworkManager
 {
 public:
+    static constexpr enet_uint8 channelCount = 3;
+    static constexpr enet_uint8 clockSyncChannel = 2; // ping/pong, handled here and never passed on
+    static constexpr size_t maxPeers = 32;
+
     NetworkManager();
     ~NetworkManager();
 
@@ -30,17 +61,81 @@ public:
     bool startServer(enet_uint16 port);
     bool startClient(const std::string &host, enet_uint16 port);
 
+    // Server: also accept clients on 127.0.0.1:relayPort through a relay that impairs the link (testing,
+    // benchmarks); clients connecting there see the given latency, jitter, loss, duplication and reordering
+    bool startLinkSimulation(enet_uint16 relayPort, const LinkConditions &toServer, const LinkConditions &toClient);
+    LoopbackRelay::Stats getLinkSimulationStats() const { return relay.getStats(); }
+
     template <typename T>
-    void send(const T &packet, enet_uint8 channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE)
+    void send(const T &packet, enet_uint8 channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE, Recipients to = Recipients::All)
+    {
+        sendBytes(&packet, sizeof(T), channel, flags, to);
+    }
+
+    // Queue bytes for sending; nothing leaves the host until flush()
+    void sendBytes(const void *data, size_t size, enet_uint8 channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE, Recipients to = Recipients::All);
+
+    // Zero-copy send: encode straight into a pooled buffer (PacketPool::bufferSize bytes), then hand it over.
+    // The buffer belongs to the packet afterwards and returns to the pool once all peers are done with it.
+    // One packet serves all recipients, however many there are.
+    uint8_t *acquireSendBuffer() { return sendPool.acquire(); }
+    void releaseSendBuffer(uint8_t *buffer) { sendPool.release(buffer); } // acquired but not sent
+    void sendBuffer(uint8_t *buffer, size_t size, enet_uint8 channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE, Recipients to = Recipients::All);
+
+    // Hand all queued packets to the socket, once per network tick
+    void flush();
+
+    // Block until the host socket has data, wake() was called or timeoutMs passed
+    void waitForActivity(enet_uint32 timeoutMs);
+
+    // Interrupt waitForActivity() from another thread, e.g. when outgoing data was queued
+    void wake();
+
+    // Service ENet: dispatch events into the receive queue, answer pings, update stats.
+    // Received packets are never dropped; while the receive queue is full they are left with ENet.
+    void service();
+    // Take a received packet, false when nothing is queued.
+    // The caller owns the returned packet and gives it back with releasePacket().
+    bool takePacket(ENetPacket *&packet) { return packetQueue.pop(packet); }
+    bool pollEvent(ENetPacket *&packet)
     {
-        send(&packet, sizeof(T), channel, flags);
+        service();
+        return takePacket(packet);
     }
+    void releasePacket(ENetPacket *packet) { enet_packet_destroy(packet); }
+
+    // service() calls that stopped early because the receive queue was full
+    size_t getReceiveStalls() const { return receiveStalls.load(std::memory_order_relaxed); }
+    size_t getSendPoolExhausted() const { return sendPool.getExhaustedCount(); }
 
-    // Poll for received packets
-    std::optional<std::vector<uint8_t>> pollEvent();
+    // bytes per second queued for a peer over the last second (peer index on the server, 0 on a client), any thread
+    size_t getPeerSendRate(size_t peerIndex) const { return peerIndex < maxPeers ? peerSendRates[peerIndex].load(std::memory_order_relaxed) : 0; }
 
-    // Connection state (updated during pollEvent())
+    // Connection state (updated during service()); on a server, whether the player is connected
     bool isConnected() const;
+    bool isConnectionLost() const { return connectionLost.load(); } // client: the server went away or never answered
+    uint32_t getConnectionCount() const { return connections.load(); } // connections made so far, tells a quick reconnect apart
+
+    // server: connected spectators, and how many of them still wait for a join snapshot, any thread
+    size_t getSpectatorCount() const { return spectatorCount.load(std::memory_order_relaxed); }
+    size_t getJoiningSpectatorCount() const { return joiningSpectatorCount.load(std::memory_order_relaxed); }
+
+    // Clock sync with the peer (a server syncs with its first client). service() pings every
+    // pingInterval and answers the peer's pings; the results can be read from any thread.
+    static double clockNow(); // steady clock seconds, the time base of all clock values
+    void setLocalTickClock(double tickEpoch, float tickRate); // clockNow() of our tick 0, sent with pongs
+    bool getRemoteTickClock(double &tickEpoch, float &tickRate) const; // the peer's tick 0 in our clock
+    double getRtt() const { return rtt.load(std::memory_order_relaxed); }
+    double getRttJitter() const { return rttJitter.load(std::memory_order_relaxed); }
+    double getClockOffset() const { return clockOffset.load(std::memory_order_relaxed); } // peer clock - ours
+
+    // ENet's round trip, loss and throttle for the same peer, any thread
+    LinkStats getLinkStats() const;
+
+    // Traffic per channel, retransmits, loss and queue depths over the last second, any thread.
+    // The owner of the network thread reports its own queues once per network tick.
+    NetworkStats::Report getStats() const { return stats.read(); }
+    void sampleQueues(size_t incoming, size_t outgoing, size_t incomingStalls);
 
     void startServerDiscoveryAsync(uint16_t broadcastPort = 12345, int timeoutSeconds = 1);
     void stopServerDiscoveryAsync();
@@ -54,11 +149,65 @@ private:
     ENetHost *host;
     ENetPeer *peer;
     bool isServer;
+    enet_uint16 serverPort = 0;
+
+    LoopbackRelay relay;
 
     std::atomic<bool> connected{false};
+    std::atomic<bool> connectionLost{false};
+    std::atomic<uint32_t> connections{0};
 
-    std::queue<std::vector<uint8_t>> packetQueue;
-    std::mutex queueMutex;
+    // server: peer roles by peer index, owned by the network thread
+    enum class PeerRole : uint8_t
+    {
+        None,
+        Player,
+        Spectator,
+        JoiningSpectator
+    };
+    std::array<PeerRole, maxPeers> peerRoles{};
+    ENetPeer *playerPeer = nullptr;
+    std::atomic<uint32_t> spectatorCount{0};
+    std::atomic<uint32_t> joiningSpectatorCount{0};
+
+    // loopback datagram socket used as a self-pipe to wake the network thread
+    ENetSocket wakeSocket = ENET_SOCKET_NULL;
+    ENetAddress wakeAddress{};
+
+    // received ENet packets, passed on without copying; filled and drained by the network thread
+    SpscQueue<ENetPacket *, 64> packetQueue;
+    std::atomic<size_t> receiveStalls{0};
+
+    PacketPool sendPool;
+
+    // send rate accounting, counted by the network thread and published once per second
+    std::array<uint64_t, maxPeers> peerBytesSent{};
+    std::array<std::atomic<uint32_t>, maxPeers> peerSendRates{};
+    double sendRateWindowStart = 0.0;
+
+    NetworkStats stats; // counted by the network thread, published once per second
+
+    // clock sync state, owned by the network thread
+    static constexpr double pingInterval = 0.25; // seconds
+    ClockSync clockSync;
+    ENetPeer *clockPeer = nullptr;
+    uint32_t pingSequence = 0;
+    uint32_t lastPongSequence = 0; // older pongs arriving late are ignored
+    double lastPingTime = 0.0;
+
+    // published for the game thread
+    std::atomic<double> rtt{0.0};
+    std::atomic<double> rttJitter{0.0};
+    std::atomic<double> clockOffset{0.0};
+    std::atomic<double> remoteTickEpoch{0.0};
+    std::atomic<float> remoteTickRate{0.f};
+    std::atomic<double> localTickEpoch{0.0};
+    std::atomic<float> localTickRate{0.f};
+
+    std::atomic<uint32_t> linkRoundTripTime{0};
+    std::atomic<uint32_t> linkRoundTripTimeVariance{0};
+    std::atomic<float> linkPacketLoss{0.f};
+    std::atomic<float> linkThrottle{1.f};
 
     std::atomic<bool> discoveryStopRequested{false};
     std::atomic<bool> discoveryRunning{false};
@@ -66,13 +215,23 @@ private:
     std::queue<std::string> discoveryQueue;
     std::mutex discoveryMutex;
 
-    // Send packets
-    void send(const void *data, size_t size, enet_uint8 channel = 0, enet_uint32 flags = ENET_PACKET_FLAG_RELIABLE);
+    // queue one packet on the server peer, or on every recipient client (shared, refcounted by ENet)
+    void SendToServer(ENetPacket *packet, enet_uint8 channel);
+    void SendToClient(ENetPacket *packet, enet_uint8 channel, Recipients to);
+    void dispatch(ENetPacket *packet, enet_uint8 channel, Recipients to);
+
+    size_t peerIndex(const ENetPeer *p) const { return (size_t)(p - host->peers); }
+    void addPeer(ENetPeer *p);
+    void removePeer(ENetPeer *p);
+    void resetPeers();
 
-    void SendToServer(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags);
-    void SendToClient(const void *data, size_t size, enet_uint8 channel, enet_uint32 flags);
+    void countSent(const ENetPeer *to, const ENetPacket *packet, enet_uint8 channel);
+    void updateSendRates(double now);
+    void updateStats(double now);
 
-    void PushPacket(const void *data, size_t size);
+    void resetClockSync();
+    void sendPing(double now);
+    void handleClockSync(ENetPeer *from, const ENetPacket *packet, double now);
 };
 
 inline void BroadcastServer(std::atomic<bool> &running, uint16_t broadcastPort = 12345)
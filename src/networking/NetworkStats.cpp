@@ -0,0 +1,184 @@
+#include "NetworkStats.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<NetworkStats::Report>, "the report is published word by word");
+
+NetworkStats::NetworkStats()
+{
+    for (std::atomic<uint64_t> &word : published)
+        word.store(0, std::memory_order_relaxed);
+}
+
+void NetworkStats::reset()
+{
+    lastPacketsLost.fill(0);
+    baselineValid = false;
+}
+
+void NetworkStats::countSent(size_t channel, size_t bytes)
+{
+    if (channel >= maxChannels)
+        return;
+    pending.channels[channel].packetsOut++;
+    bytesOut[channel] += bytes;
+}
+
+void NetworkStats::countReceived(size_t channel, size_t bytes)
+{
+    if (channel >= maxChannels)
+        return;
+    pending.channels[channel].packetsIn++;
+    bytesIn[channel] += bytes;
+}
+
+void NetworkStats::sampleQueues(size_t receive, size_t incoming, size_t outgoing)
+{
+    auto sample = [](QueueDepth &depth, size_t size)
+    {
+        depth.current = (uint32_t)size;
+        if (depth.current > depth.peak)
+            depth.peak = depth.current;
+    };
+    sample(pending.receiveQueue, receive);
+    sample(pending.incomingQueue, incoming);
+    sample(pending.outgoingQueue, outgoing);
+}
+
+void NetworkStats::sampleRetransmits(size_t peerIndex, uint32_t packetsLost)
+{
+    if (peerIndex >= maxPeers)
+        return;
+
+    // ENet zeroes the count with every loss estimate; what was lost since the last sample is then gone,
+    // sampling every network tick keeps that small
+    const uint32_t last = lastPacketsLost[peerIndex];
+    retransmitsPending += packetsLost >= last ? packetsLost - last : packetsLost;
+    lastPacketsLost[peerIndex] = packetsLost;
+}
+
+bool NetworkStats::publish(double now, uint32_t totalSentData, uint32_t totalReceivedData, uint32_t peers, double rtt, double rttJitter, uint32_t enetRtt, float packetLoss)
+{
+    if (intervalStart <= 0.0)
+        intervalStart = now;
+    const double elapsed = now - intervalStart;
+    if (elapsed < publishInterval)
+        return false;
+
+    Report report = pending;
+    report.sequence = ++publishes;
+    report.interval = (float)elapsed;
+    report.time = now;
+    report.rtt = rtt;
+    report.rttJitter = rttJitter;
+    report.enetRtt = enetRtt;
+    report.packetLoss = packetLoss;
+    report.peers = peers;
+    report.retransmits = (uint32_t)(retransmitsPending / elapsed);
+    for (size_t i = 0; i < maxChannels; i++)
+    {
+        report.channels[i].packetsOut = (uint32_t)(pending.channels[i].packetsOut / elapsed);
+        report.channels[i].packetsIn = (uint32_t)(pending.channels[i].packetsIn / elapsed);
+        report.channels[i].bytesOut = (uint32_t)(bytesOut[i] / elapsed);
+        report.channels[i].bytesIn = (uint32_t)(bytesIn[i] / elapsed);
+    }
+    // ENet's totals wrap, the unsigned difference does not mind
+    report.wireBytesOut = baselineValid ? (uint32_t)((totalSentData - lastSentData) / elapsed) : 0;
+    report.wireBytesIn = baselineValid ? (uint32_t)((totalReceivedData - lastReceivedData) / elapsed) : 0;
+
+    uint64_t words[reportWords] = {};
+    std::memcpy(words, &report, sizeof(report));
+    const uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < reportWords; i++)
+        published[i].store(words[i], std::memory_order_relaxed);
+    sequence.store(start + 2, std::memory_order_release);
+
+    // next interval; the queue depths start from where they are
+    const Report carried = pending;
+    pending = Report{};
+    pending.receiveStalls = carried.receiveStalls;
+    pending.receiveQueue = QueueDepth{carried.receiveQueue.current, carried.receiveQueue.current};
+    pending.incomingQueue = QueueDepth{carried.incomingQueue.current, carried.incomingQueue.current};
+    pending.outgoingQueue = QueueDepth{carried.outgoingQueue.current, carried.outgoingQueue.current};
+    retransmitsPending = 0;
+    bytesOut.fill(0);
+    bytesIn.fill(0);
+    lastSentData = totalSentData;
+    lastReceivedData = totalReceivedData;
+    baselineValid = true;
+    intervalStart = now;
+    return true;
+}
+
+NetworkStats::Report NetworkStats::read() const
+{
+    uint64_t words[reportWords];
+    for (;;)
+    {
+        const uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1u)
+            continue; // being written, done in a moment
+
+        for (size_t i = 0; i < reportWords; i++)
+            words[i] = published[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            break;
+    }
+
+    Report report;
+    std::memcpy(&report, words, sizeof(report));
+    return report;
+}
+
+bool NetworkStatsLog::open(const std::string &filePath)
+{
+    close();
+    file.open(filePath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filePath << " for network statistics\n";
+        return false;
+    }
+
+    path = filePath;
+    lastSequence = 0;
+    startTime = 0.0;
+    file << "seconds,interval,peers,rtt_ms,rtt_jitter_ms,enet_rtt_ms,packet_loss,retransmits";
+    for (size_t i = 0; i < NetworkStats::maxChannels; i++)
+        file << ",ch" << i << "_packets_out,ch" << i << "_bytes_out,ch" << i << "_packets_in,ch" << i << "_bytes_in";
+    file << ",wire_bytes_out,wire_bytes_in,receive_queue,receive_queue_peak,incoming_queue,incoming_queue_peak,"
+            "outgoing_queue,outgoing_queue_peak,receive_stalls\n";
+    std::cout << "Writing network statistics to " << path << "\n";
+    return true;
+}
+
+void NetworkStatsLog::write(const NetworkStats::Report &report)
+{
+    if (!file.is_open() || report.sequence == 0 || report.sequence == lastSequence)
+        return;
+    lastSequence = report.sequence;
+    if (startTime <= 0.0)
+        startTime = report.time;
+
+    file << report.time - startTime << ',' << report.interval << ',' << report.peers << ',' << report.rtt * 1000.0 << ','
+         << report.rttJitter * 1000.0 << ',' << report.enetRtt << ',' << report.packetLoss << ',' << report.retransmits;
+    for (const NetworkStats::ChannelTraffic &channel : report.channels)
+        file << ',' << channel.packetsOut << ',' << channel.bytesOut << ',' << channel.packetsIn << ',' << channel.bytesIn;
+    file << ',' << report.wireBytesOut << ',' << report.wireBytesIn << ',' << report.receiveQueue.current << ',' << report.receiveQueue.peak << ','
+         << report.incomingQueue.current << ',' << report.incomingQueue.peak << ',' << report.outgoingQueue.current << ','
+         << report.outgoingQueue.peak << ',' << report.receiveStalls << '\n';
+    file.flush(); // a crash should not take the last minutes with it
+}
+
+void NetworkStatsLog::close()
+{
+    if (!file.is_open())
+        return;
+    file.close();
+    std::cout << "Network statistics written to " << path << "\n";
+}
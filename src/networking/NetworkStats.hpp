@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Traffic, queue and link statistics of the network thread. The network thread counts into plain
+// members and publishes a Report once per second; any thread reads the last one with read(), without
+// locks: the report is copied through atomic words guarded by a sequence number (a seqlock), so a
+// reader retries instead of seeing half of one second and half of the next.
+class NetworkStats
+{
+public:
+    static constexpr size_t maxChannels = 4;
+    static constexpr double publishInterval = 1.0; // seconds
+
+    struct ChannelTraffic
+    {
+        uint32_t packetsOut = 0; // per second, a packet queued on N peers counts N times
+        uint32_t bytesOut = 0;
+        uint32_t packetsIn = 0;
+        uint32_t bytesIn = 0;
+    };
+
+    struct QueueDepth
+    {
+        uint32_t current = 0; // at the publish
+        uint32_t peak = 0;    // over the interval
+    };
+
+    struct Report
+    {
+        uint32_t sequence = 0; // publishes so far, 0 = nothing yet
+        float interval = 0.f;  // seconds the rates cover
+        double time = 0.0;     // NetworkManager::clockNow() of the publish
+
+        // ping/pong with the clock peer (the server, or the player on the server), seconds
+        double rtt = 0.0;
+        double rttJitter = 0.0;
+
+        // ENet's view of the same peer
+        uint32_t enetRtt = 0;       // ms
+        float packetLoss = 0.f;     // 0..1, ENet's running estimate for reliable packets
+        uint32_t retransmits = 0;   // reliable resends per second, all peers
+
+        std::array<ChannelTraffic, maxChannels> channels{};
+        uint32_t wireBytesOut = 0; // per second, with ENet's headers, acks and resends
+        uint32_t wireBytesIn = 0;
+
+        QueueDepth receiveQueue;  // received, waiting for the network thread's consumer
+        QueueDepth incomingQueue; // handed to the game thread, not parsed yet
+        QueueDepth outgoingQueue; // encoded by the game thread, not sent yet
+        uint32_t receiveStalls = 0; // since the start, polls that left packets with ENet because a queue was full
+
+        uint32_t peers = 0; // connected
+    };
+
+    NetworkStats();
+
+    // network thread
+    void reset(); // new host: ENet's counters start over
+    void countSent(size_t channel, size_t bytes);
+    void countReceived(size_t channel, size_t bytes);
+    void sampleQueues(size_t receive, size_t incoming, size_t outgoing);
+    void sampleRetransmits(size_t peerIndex, uint32_t packetsLost); // ENet's per-peer count, reset by ENet now and then
+    void setReceiveStalls(size_t stalls) { pending.receiveStalls = (uint32_t)stalls; }
+
+    // true when a report was due and published; the caller fills in the link values first
+    bool publish(double now, uint32_t totalSentData, uint32_t totalReceivedData, uint32_t peers, double rtt, double rttJitter, uint32_t enetRtt, float packetLoss);
+
+    // any thread
+    Report read() const;
+
+private:
+    static constexpr size_t maxPeers = 32;
+    static constexpr size_t reportWords = (sizeof(Report) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // counted over the current interval, network thread only
+    Report pending;
+    uint64_t retransmitsPending = 0;
+    std::array<uint64_t, maxChannels> bytesOut{};
+    std::array<uint64_t, maxChannels> bytesIn{};
+    std::array<uint32_t, maxPeers> lastPacketsLost{};
+    double intervalStart = 0.0;
+    uint32_t lastSentData = 0;
+    uint32_t lastReceivedData = 0;
+    bool baselineValid = false; // lastSentData/lastReceivedData belong to the current host
+    uint32_t publishes = 0;
+
+    // the published report, odd sequence while it is being written
+    std::atomic<uint32_t> sequence{0};
+    std::array<std::atomic<uint64_t>, reportWords> published;
+};
+
+// Appends a line per report to a CSV file, for plotting a session afterwards
+class NetworkStatsLog
+{
+public:
+    bool open(const std::string &path);
+    void write(const NetworkStats::Report &report); // once per report, repeats are skipped
+    void close();
+
+    bool isOpen() const { return file.is_open(); }
+    const std::string &getPath() const { return path; }
+
+private:
+    std::ofstream file;
+    std::string path;
+    uint32_t lastSequence = 0;
+    double startTime = 0.0;
+};
@@ -0,0 +1,47 @@
+#include "PacketPool.hpp"
+
+PacketPool::PacketPool(size_t bufferCount)
+    : storage(bufferCount * bufferSize)
+{
+    freeList.reserve(bufferCount);
+    for (size_t i = 0; i < bufferCount; i++)
+        freeList.push_back(storage.data() + i * bufferSize);
+}
+
+uint8_t *PacketPool::acquire()
+{
+    if (freeList.empty())
+    {
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint8_t *buffer = freeList.back();
+    freeList.pop_back();
+    return buffer;
+}
+
+void PacketPool::release(uint8_t *buffer)
+{
+    if (buffer)
+        freeList.push_back(buffer); // capacity reserved up front, never reallocates
+}
+
+ENetPacket *PacketPool::wrap(uint8_t *buffer, size_t size, enet_uint32 flags)
+{
+    ENetPacket *packet = enet_packet_create(buffer, size, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+    if (!packet)
+    {
+        release(buffer);
+        return nullptr;
+    }
+
+    packet->userData = this;
+    packet->freeCallback = &PacketPool::onPacketFree;
+    return packet;
+}
+
+void PacketPool::onPacketFree(ENetPacket *packet)
+{
+    static_cast<PacketPool *>(packet->userData)->release(packet->data);
+}
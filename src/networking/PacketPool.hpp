@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <enet/enet.h>
+
+// Fixed set of send buffers that ENet packets point into (ENET_PACKET_FLAG_NO_ALLOCATE).
+// A buffer goes back to the free list from the packet's freeCallback, i.e. once every peer
+// the packet was queued on is done with it. Only used from the network thread.
+class PacketPool
+{
+public:
+    static constexpr size_t bufferSize = 16 * 1024; // fits a full snapshot; larger payloads fall back to a copying enet_packet_create
+
+    explicit PacketPool(size_t bufferCount = 32);
+
+    PacketPool(const PacketPool &) = delete;
+    PacketPool &operator=(const PacketPool &) = delete;
+
+    // nullptr when every buffer is still referenced by an in-flight packet
+    uint8_t *acquire();
+    void release(uint8_t *buffer);
+
+    // packet referencing `buffer` without copying; the buffer is released when ENet destroys the packet
+    ENetPacket *wrap(uint8_t *buffer, size_t size, enet_uint32 flags);
+
+    size_t getAvailable() const { return freeList.size(); }
+    size_t getExhaustedCount() const { return exhausted.load(std::memory_order_relaxed); } // readable from any thread
+
+private:
+    static void onPacketFree(ENetPacket *packet);
+
+    std::vector<uint8_t> storage;
+    std::vector<uint8_t *> freeList;
+    std::atomic<size_t> exhausted{0};
+};
@@ -0,0 +1,78 @@
+#include "Replay.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr char replayMagic[4] = {'C', 'T', 'F', 'R'};
+    constexpr uint32_t replayVersion = 1;
+    constexpr uint32_t maxFrameEntities = 1u << 16; // sanity limit for broken files
+}
+
+bool ReplayWriter::open(const std::string &filePath)
+{
+    close();
+
+    file.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open replay file " << filePath << "\n";
+        return false;
+    }
+
+    file.write(replayMagic, sizeof(replayMagic));
+    file.write(reinterpret_cast<const char *>(&replayVersion), sizeof(replayVersion));
+
+    path = filePath;
+    frames = 0;
+    return true;
+}
+
+void ReplayWriter::writeFrame(uint32_t tick, const std::vector<EntityState> &states)
+{
+    if (!file.is_open())
+        return;
+
+    const uint32_t count = (uint32_t)states.size();
+    file.write(reinterpret_cast<const char *>(&tick), sizeof(tick));
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char *>(states.data()), (std::streamsize)(count * sizeof(EntityState)));
+    frames++;
+}
+
+void ReplayWriter::close()
+{
+    if (!file.is_open())
+        return;
+
+    file.close();
+    std::cout << "Replay saved: " << path << " (" << frames << " frames)\n";
+}
+
+bool ReplayReader::open(const std::string &filePath)
+{
+    file.open(filePath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[4] = {};
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+
+    return file && std::memcmp(magic, replayMagic, sizeof(magic)) == 0 && version == replayVersion;
+}
+
+bool ReplayReader::readFrame(uint32_t &tick, std::vector<EntityState> &states)
+{
+    uint32_t count = 0;
+    file.read(reinterpret_cast<char *>(&tick), sizeof(tick));
+    file.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!file || count > maxFrameEntities)
+        return false;
+
+    states.resize(count);
+    file.read(reinterpret_cast<char *>(states.data()), (std::streamsize)(count * sizeof(EntityState)));
+    return (bool)file;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../core/Entity.hpp"
+
+// Recorded matches: the full entity state at snapshot rate, used to benchmark the snapshot codec
+// on real battles. Raw EntityState records, so files are only portable between identical builds.
+//
+// File: "CTFR" version(u32) { tick(u32) count(u32) EntityState[count] }*
+class ReplayWriter
+{
+public:
+    bool open(const std::string &path);
+    void writeFrame(uint32_t tick, const std::vector<EntityState> &states);
+    void close();
+
+    bool isOpen() const { return file.is_open(); }
+    size_t getFrames() const { return frames; }
+    const std::string &getPath() const { return path; }
+
+private:
+    std::ofstream file;
+    std::string path;
+    size_t frames = 0;
+};
+
+class ReplayReader
+{
+public:
+    bool open(const std::string &path);
+    bool readFrame(uint32_t &tick, std::vector<EntityState> &states); // false at the end or on a broken file
+
+private:
+    std::ifstream file;
+};
@@ -0,0 +1,135 @@
+#include "ReplicationScheduler.hpp"
+
+#include "SnapshotCodec.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr float gridOrigin = -256.f; // SnapshotQuantization::positionMin
+
+    // merge walk helper: the state with `id` in a list sorted by id, advancing `cursor`
+    const EntityState *findSorted(const std::vector<EntityState> *states, size_t &cursor, int32_t id)
+    {
+        if (!states)
+            return nullptr;
+        while (cursor < states->size() && (*states)[cursor].id < id)
+            cursor++;
+        return cursor < states->size() && (*states)[cursor].id == id ? &(*states)[cursor] : nullptr;
+    }
+}
+
+ReplicationScheduler::ReplicationScheduler(const ReplicationWeights &weights)
+    : weights(weights)
+{
+}
+
+void ReplicationScheduler::reset()
+{
+    entries.clear();
+    sentLastSnapshot = 0;
+    deferredLastSnapshot = 0;
+}
+
+void ReplicationScheduler::select(const SnapshotCodec &codec, float elapsed, size_t budgetBytes, const std::vector<EntityState> &current,
+                                  const std::vector<EntityState> *baseline, const std::vector<EntityState> *latest, std::vector<EntityState> &out)
+{
+    // entries follow the current entity set, new ones first in line
+    entriesScratch.clear();
+    {
+        size_t e = 0;
+        for (const EntityState &state : current)
+        {
+            while (e < entries.size() && entries[e].id < state.id)
+                e++;
+            if (e < entries.size() && entries[e].id == state.id)
+                entriesScratch.push_back(entries[e]);
+            else
+                entriesScratch.push_back(Entry{state.id, weights.newEntity, state.position, state.health});
+        }
+    }
+    entries.swap(entriesScratch);
+
+    // where the fighting is
+    fightGrid.clear();
+    for (uint32_t i = 0; i < (uint32_t)current.size(); i++)
+        if (current[i].shooting)
+            fightGrid.update(i, {current[i].position.x - gridOrigin, current[i].position.y - gridOrigin, 0.f, 0.f});
+
+    // grow the accumulators, work out what each choice costs
+    long mandatoryBits = 0;
+    candidates.clear();
+    order.clear();
+    size_t b = 0, l = 0;
+    for (uint32_t i = 0; i < (uint32_t)current.size(); i++)
+    {
+        const EntityState &state = current[i];
+        Entry &entry = entries[i];
+
+        float weight = weights.base;
+        weight += std::min(Vector2Distance(state.position, entry.sentPosition) * weights.motion, weights.maxMotion);
+        if (state.health < entry.sentHealth)
+            weight += weights.healthChange;
+
+        bool inFight = state.shooting;
+        if (!inFight)
+        {
+            const float r = weights.fightRadius;
+            fightGrid.query({state.position.x - gridOrigin - r, state.position.y - gridOrigin - r, 2.f * r, 2.f * r}, [&](uint32_t shooter)
+                            { inFight = inFight || (current[shooter].team != state.team && Vector2Distance(current[shooter].position, state.position) <= r); });
+        }
+        if (inFight)
+            weight += weights.fight;
+        entry.priority += elapsed * weight;
+
+        const EntityState *base = findSorted(baseline, b, state.id);
+        const EntityState *fallback = findSorted(latest, l, state.id);
+        if (!fallback)
+            fallback = base;
+
+        const long fallbackBits = fallback ? (long)codec.updateBits(base, *fallback) : 0;
+        const long currentBits = (long)codec.updateBits(base, state);
+        mandatoryBits += fallbackBits;
+
+        // nothing new for the peer, or cheaper than what it costs anyway
+        const bool upToDate = fallback && codec.updateBits(fallback, state) == 0;
+        candidates.push_back(Candidate{fallback, currentBits - fallbackBits, upToDate || currentBits <= fallbackBits});
+        if (!candidates.back().send)
+            order.push_back(i);
+    }
+
+    // greedy by priority, smaller updates still fill what is left after a big one did not fit
+    std::sort(order.begin(), order.end(), [this](uint32_t x, uint32_t y)
+              { return entries[x].priority > entries[y].priority; });
+
+    constexpr long headerBits = 64 + 2 * 8; // ticks, removal and update counts
+    long remaining = (long)budgetBytes * 8 - headerBits - mandatoryBits;
+    for (uint32_t i : order)
+    {
+        if (candidates[i].extraBits > remaining)
+            continue;
+        candidates[i].send = true;
+        remaining -= candidates[i].extraBits;
+    }
+
+    out.clear();
+    sentLastSnapshot = 0;
+    deferredLastSnapshot = 0;
+    for (uint32_t i = 0; i < (uint32_t)current.size(); i++)
+    {
+        if (candidates[i].send)
+        {
+            out.push_back(current[i]);
+            entries[i].priority = 0.f;
+            entries[i].sentPosition = current[i].position;
+            entries[i].sentHealth = current[i].health;
+            sentLastSnapshot++;
+        }
+        else
+        {
+            if (candidates[i].fallback) // without one it was never sent and stays unknown to the peer for now
+                out.push_back(*candidates[i].fallback);
+            deferredLastSnapshot++;
+        }
+    }
+}
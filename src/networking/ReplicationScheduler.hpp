@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../core/Entity.hpp"
+#include "../utils/SpatialGrid.hpp"
+
+class SnapshotCodec;
+
+// How fast an entity's send priority grows; the rates add up while the condition holds.
+struct ReplicationWeights
+{
+    float base = 1.f;            // per second since last sent
+    float motion = 0.1f;         // per world unit moved since last sent
+    float maxMotion = 4.f;
+    float healthChange = 2.f;    // any health lost since last sent
+    float fight = 2.f;           // shooting, or within fightRadius of something shooting
+    float fightRadius = 150.f;
+    float newEntity = 100.f;     // initial priority, a new unit should show up right away
+};
+
+// Decides which entity updates go into the next snapshot for one peer when not everything fits its
+// byte budget. Every entity has a priority accumulator that grows with the time since it was last
+// sent, faster for entities that moved, lost health or are close to a fight; the snapshot takes the
+// highest priorities that still fit, sent entities start over at zero.
+//
+// Entities that are not picked keep the state the peer got last, so the delta against its baseline
+// still tells the whole truth; only that state is older.
+class ReplicationScheduler
+{
+public:
+    explicit ReplicationScheduler(const ReplicationWeights &weights = ReplicationWeights{});
+
+    void reset();
+
+    // `current` sorted by id and already quantized (SnapshotCodec::roundTrip); `baseline` is what the
+    // snapshot is encoded against, `latest` what the peer was sent last (either may be null).
+    // `out` receives the states to encode, sorted by id.
+    void select(const SnapshotCodec &codec, float elapsed, size_t budgetBytes, const std::vector<EntityState> &current,
+                const std::vector<EntityState> *baseline, const std::vector<EntityState> *latest, std::vector<EntityState> &out);
+
+    size_t getSentLastSnapshot() const { return sentLastSnapshot; }
+    size_t getDeferredLastSnapshot() const { return deferredLastSnapshot; }
+
+private:
+    struct Entry
+    {
+        int32_t id;
+        float priority;
+        Vector2 sentPosition;
+        float sentHealth;
+    };
+
+    // per entity of `current` for one select(), index aligned
+    struct Candidate
+    {
+        const EntityState *fallback; // what the peer keeps if not sent
+        long extraBits;              // cost of sending the current state instead
+        bool send;
+    };
+
+    ReplicationWeights weights;
+
+    std::vector<Entry> entries; // sorted by id, survives between snapshots
+    std::vector<Entry> entriesScratch;
+    std::vector<Candidate> candidates;
+    std::vector<uint32_t> order;
+    SpatialGrid<uint32_t> fightGrid{1312.f, 1312.f, 150.f}; // the codec's position range, see SnapshotQuantization
+
+    size_t sentLastSnapshot = 0;
+    size_t deferredLastSnapshot = 0;
+};
@@ -0,0 +1,344 @@
+#include "SnapshotCodec.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BitStream.hpp"
+
+namespace
+{
+    // mirrors the unit classes: health of a full unit and attack cooldown (cooldowns beyond it behave the same)
+    struct KindLimits
+    {
+        float maxHealth;
+        float maxCooldown;
+    };
+
+    constexpr KindLimits kindLimits[4] = {
+        {100.f, 1.f},   // Infantry
+        {100.f, 0.5f},  // Cavalry
+        {200.f, 2.f},   // Artillery
+        {1000.f, 0.f},  // Base
+    };
+
+    constexpr float soldierHealth = 100.f / 7.f;
+
+    enum FieldMask : uint32_t
+    {
+        PositionChanged = 1u << 0,
+        DesiredChanged = 1u << 1,
+        HealthChanged = 1u << 2,
+        CooldownChanged = 1u << 3,
+        AllFields = 0xF
+    };
+
+    const KindLimits &limitsOf(UnitKind kind)
+    {
+        return kindLimits[std::min<size_t>((size_t)kind, 3)];
+    }
+
+    uint32_t quantizeRange(float value, float min, float step, uint32_t maxQ)
+    {
+        const float q = std::round((value - min) / step);
+        if (q <= 0.f)
+            return 0;
+        return std::min((uint32_t)q, maxQ);
+    }
+}
+
+SnapshotCodec::SnapshotCodec(const SnapshotQuantization &quantization)
+    : quantization(quantization)
+{
+    healthStep = soldierHealth / (float)std::max(1, quantization.healthStepsPerSoldier);
+    positionMaxQ = (uint32_t)std::ceil((quantization.positionMax - quantization.positionMin) / quantization.positionStep);
+    positionBits = bitsFor(positionMaxQ);
+}
+
+SnapshotCodec::Quantized SnapshotCodec::quantize(const EntityState &state) const
+{
+    const KindLimits &limits = limitsOf(state.kind);
+    const uint32_t healthMaxQ = (uint32_t)std::ceil(limits.maxHealth / healthStep - 0.001f);
+    const uint32_t cooldownMaxQ = (uint32_t)std::ceil(limits.maxCooldown / quantization.cooldownStep);
+
+    Quantized q{};
+    q.position[0] = quantizeRange(state.position.x, quantization.positionMin, quantization.positionStep, positionMaxQ);
+    q.position[1] = quantizeRange(state.position.y, quantization.positionMin, quantization.positionStep, positionMaxQ);
+    q.desired[0] = quantizeRange(state.desiredPosition.x, quantization.positionMin, quantization.positionStep, positionMaxQ);
+    q.desired[1] = quantizeRange(state.desiredPosition.y, quantization.positionMin, quantization.positionStep, positionMaxQ);
+
+    // rounded up so a unit with a sliver of health left is not dead on the receiver
+    q.health = state.health <= 0.f ? 0 : std::min((uint32_t)std::ceil(state.health / healthStep - 0.001f), healthMaxQ);
+    q.cooldown = quantizeRange(std::min(state.cooldown, limits.maxCooldown), 0.f, quantization.cooldownStep, cooldownMaxQ);
+    return q;
+}
+
+void SnapshotCodec::dequantize(const Quantized &q, EntityState &state) const
+{
+    const KindLimits &limits = limitsOf(state.kind);
+
+    state.position = {quantization.positionMin + q.position[0] * quantization.positionStep, quantization.positionMin + q.position[1] * quantization.positionStep};
+    state.desiredPosition = {quantization.positionMin + q.desired[0] * quantization.positionStep, quantization.positionMin + q.desired[1] * quantization.positionStep};
+    state.health = std::min((float)q.health * healthStep, limits.maxHealth);
+    state.cooldown = std::min((float)q.cooldown * quantization.cooldownStep, limits.maxCooldown);
+}
+
+EntityState SnapshotCodec::roundTrip(const EntityState &state) const
+{
+    EntityState result = state;
+    dequantize(quantize(state), result);
+    return result;
+}
+
+void SnapshotCodec::roundTrip(std::vector<EntityState> &states) const
+{
+    for (EntityState &state : states)
+        state = roundTrip(state);
+}
+
+void SnapshotCodec::writeFields(BitWriter &writer, const EntityState &state, const Quantized &q, uint32_t mask) const
+{
+    const KindLimits &limits = limitsOf(state.kind);
+
+    if (mask & PositionChanged)
+    {
+        writer.write(q.position[0], positionBits);
+        writer.write(q.position[1], positionBits);
+    }
+    if (mask & DesiredChanged)
+    {
+        writer.write(q.desired[0], positionBits);
+        writer.write(q.desired[1], positionBits);
+    }
+    if (mask & HealthChanged)
+        writer.write(q.health, bitsFor((uint32_t)std::ceil(limits.maxHealth / healthStep - 0.001f)));
+    if (mask & CooldownChanged)
+        writer.write(q.cooldown, bitsFor((uint32_t)std::ceil(limits.maxCooldown / quantization.cooldownStep)));
+}
+
+void SnapshotCodec::readFields(BitReader &reader, EntityState &state, Quantized &q, uint32_t mask) const
+{
+    const KindLimits &limits = limitsOf(state.kind);
+
+    if (mask & PositionChanged)
+    {
+        q.position[0] = reader.read(positionBits);
+        q.position[1] = reader.read(positionBits);
+    }
+    if (mask & DesiredChanged)
+    {
+        q.desired[0] = reader.read(positionBits);
+        q.desired[1] = reader.read(positionBits);
+    }
+    if (mask & HealthChanged)
+        q.health = reader.read(bitsFor((uint32_t)std::ceil(limits.maxHealth / healthStep - 0.001f)));
+    if (mask & CooldownChanged)
+        q.cooldown = reader.read(bitsFor((uint32_t)std::ceil(limits.maxCooldown / quantization.cooldownStep)));
+}
+
+size_t SnapshotCodec::encode(uint32_t tick, uint32_t baselineTick, const std::vector<EntityState> &baseline,
+                             const std::vector<EntityState> &current, uint8_t *out, size_t capacity) const
+{
+    BitWriter writer(out, capacity);
+    writer.write(tick, 32);
+    writer.write(baselineTick, 32);
+
+    // removals: in the baseline, gone now (merge walk, both sorted by id)
+    uint32_t removed = 0;
+    {
+        size_t c = 0;
+        for (const EntityState &base : baseline)
+        {
+            while (c < current.size() && current[c].id < base.id)
+                c++;
+            if (c == current.size() || current[c].id != base.id)
+                removed++;
+        }
+    }
+    writer.writeVarUint(removed);
+    {
+        size_t c = 0;
+        int32_t previousId = 0;
+        for (const EntityState &base : baseline)
+        {
+            while (c < current.size() && current[c].id < base.id)
+                c++;
+            if (c < current.size() && current[c].id == base.id)
+                continue;
+            writer.writeVarUint((uint32_t)(base.id - previousId));
+            previousId = base.id;
+        }
+    }
+
+    // updates: new entities in full, known ones with a mask of the changed fields
+    struct Update
+    {
+        const EntityState *state;
+        const EntityState *base;
+        Quantized q;
+        uint32_t mask;
+    };
+    thread_local std::vector<Update> updates;
+    updates.clear();
+
+    size_t b = 0;
+    for (const EntityState &state : current)
+    {
+        while (b < baseline.size() && baseline[b].id < state.id)
+            b++;
+        const EntityState *base = (b < baseline.size() && baseline[b].id == state.id) ? &baseline[b] : nullptr;
+
+        const Quantized q = quantize(state);
+        uint32_t mask = AllFields;
+        if (base)
+        {
+            mask = changedFields(q, quantize(*base));
+            if (mask == 0 && state.shooting == base->shooting)
+                continue; // receiver already has it
+        }
+        updates.push_back(Update{&state, base, q, mask});
+    }
+
+    writer.writeVarUint((uint32_t)updates.size());
+    int32_t previousId = 0;
+    for (const Update &update : updates)
+    {
+        writer.writeVarUint((uint32_t)(update.state->id - previousId));
+        previousId = update.state->id;
+
+        if (!update.base)
+        {
+            writer.write((uint32_t)update.state->kind, 2);
+            writer.write(update.state->team, 1);
+        }
+        else
+        {
+            writer.write(update.mask, 4);
+        }
+        writeFields(writer, *update.state, update.q, update.mask);
+        writer.writeBool(update.state->shooting);
+    }
+
+    return writer.finish();
+}
+
+size_t SnapshotCodec::updateBits(const EntityState *base, const EntityState &state) const
+{
+    constexpr size_t idGapBits = 10; // two varint groups, typical for ids a few entities apart
+
+    const Quantized q = quantize(state);
+    if (!base)
+        return idGapBits + 3 + fieldBits(state.kind, AllFields) + 1;
+
+    const uint32_t mask = changedFields(q, quantize(*base));
+    if (mask == 0 && state.shooting == base->shooting)
+        return 0;
+    return idGapBits + 4 + fieldBits(state.kind, mask) + 1;
+}
+
+uint32_t SnapshotCodec::changedFields(const Quantized &q, const Quantized &base)
+{
+    uint32_t mask = 0;
+    if (q.position[0] != base.position[0] || q.position[1] != base.position[1])
+        mask |= PositionChanged;
+    if (q.desired[0] != base.desired[0] || q.desired[1] != base.desired[1])
+        mask |= DesiredChanged;
+    if (q.health != base.health)
+        mask |= HealthChanged;
+    if (q.cooldown != base.cooldown)
+        mask |= CooldownChanged;
+    return mask;
+}
+
+size_t SnapshotCodec::fieldBits(UnitKind kind, uint32_t mask) const
+{
+    const KindLimits &limits = limitsOf(kind);
+
+    size_t bits = 0;
+    if (mask & PositionChanged)
+        bits += 2 * positionBits;
+    if (mask & DesiredChanged)
+        bits += 2 * positionBits;
+    if (mask & HealthChanged)
+        bits += bitsFor((uint32_t)std::ceil(limits.maxHealth / healthStep - 0.001f));
+    if (mask & CooldownChanged)
+        bits += bitsFor((uint32_t)std::ceil(limits.maxCooldown / quantization.cooldownStep));
+    return bits;
+}
+
+bool SnapshotCodec::peekHeader(const uint8_t *data, size_t size, uint32_t &tick, uint32_t &baselineTick)
+{
+    BitReader reader(data, size);
+    tick = reader.read(32);
+    baselineTick = reader.read(32);
+    return !reader.overflowed();
+}
+
+bool SnapshotCodec::decode(const uint8_t *data, size_t size, const std::vector<EntityState> &baseline, std::vector<EntityState> &out) const
+{
+    BitReader reader(data, size);
+    reader.read(32); // tick
+    reader.read(32); // baseline tick
+
+    // start from the baseline minus removals
+    const uint32_t removed = reader.readVarUint();
+    thread_local std::vector<int32_t> removedIds;
+    removedIds.clear();
+    int32_t id = 0;
+    for (uint32_t i = 0; i < removed && !reader.overflowed(); i++)
+    {
+        id += (int32_t)reader.readVarUint();
+        removedIds.push_back(id);
+    }
+
+    out.clear();
+    out.reserve(baseline.size());
+    size_t r = 0;
+    for (const EntityState &base : baseline)
+    {
+        while (r < removedIds.size() && removedIds[r] < base.id)
+            r++;
+        if (r < removedIds.size() && removedIds[r] == base.id)
+            continue;
+        out.push_back(base);
+    }
+
+    // updates arrive sorted, merge them in
+    const uint32_t updated = reader.readVarUint();
+    const size_t known = out.size();
+    size_t o = 0;
+    id = 0;
+    for (uint32_t i = 0; i < updated && !reader.overflowed(); i++)
+    {
+        id += (int32_t)reader.readVarUint();
+
+        while (o < known && out[o].id < id)
+            o++;
+
+        if (o < known && out[o].id == id)
+        {
+            EntityState &state = out[o];
+            Quantized q = quantize(state);
+            readFields(reader, state, q, reader.read(4));
+            state.shooting = reader.readBool();
+            dequantize(q, state);
+        }
+        else
+        {
+            EntityState state{};
+            state.id = id;
+            state.kind = (UnitKind)reader.read(2);
+            state.team = (uint8_t)reader.read(1);
+            Quantized q{};
+            readFields(reader, state, q, AllFields);
+            state.shooting = reader.readBool();
+            dequantize(q, state);
+            out.push_back(state); // appended, sorted below
+        }
+    }
+
+    if (out.size() != known)
+        std::inplace_merge(out.begin(), out.begin() + (std::ptrdiff_t)known, out.end(), [](const EntityState &a, const EntityState &b)
+                           { return a.id < b.id; });
+
+    return !reader.overflowed();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../core/Entity.hpp"
+
+class BitWriter;
+class BitReader;
+
+// Precision of replicated values. Positions cover the 800x800 world plus the bases outside of it.
+struct SnapshotQuantization
+{
+    float positionMin = -256.f;
+    float positionMax = 1056.f;
+    float positionStep = 1.f / 16.f;  // world units
+    int healthStepsPerSoldier = 4;    // health resolution as a fraction of one soldier (100 / 7 hp)
+    float cooldownStep = 1.f / 32.f;  // seconds
+};
+
+// Bit-packed snapshot encoding, delta compressed against a baseline the receiver already has.
+// Only entities whose quantized state differs from the baseline are written; entities missing
+// from the new state are sent as removals. An empty baseline gives a full snapshot.
+//
+// Layout: tick(32) baselineTick(32) removed(var) {idGap(var)} updated(var)
+//         {idGap(var) [new: kind(2) team(1) pos desired health cooldown | known: mask(4) fields] shooting(1)}
+class SnapshotCodec
+{
+public:
+    explicit SnapshotCodec(const SnapshotQuantization &quantization = SnapshotQuantization{});
+
+    // both lists sorted by id; returns the encoded size, 0 when `capacity` is too small
+    size_t encode(uint32_t tick, uint32_t baselineTick, const std::vector<EntityState> &baseline,
+                  const std::vector<EntityState> &current, uint8_t *out, size_t capacity) const;
+
+    // ticks only, to pick the baseline before decoding
+    static bool peekHeader(const uint8_t *data, size_t size, uint32_t &tick, uint32_t &baselineTick);
+
+    // `baseline` must be the state the sender encoded against; `out` is sorted by id
+    bool decode(const uint8_t *data, size_t size, const std::vector<EntityState> &baseline, std::vector<EntityState> &out) const;
+
+    // size of the record encode() writes for `state` against `base` (nullptr: new entity), 0 if nothing
+    // changed; the id gap is estimated. For send schedulers picking what fits a packet.
+    size_t updateBits(const EntityState *base, const EntityState &state) const;
+
+    // the state as the receiver will see it; senders keep these as future baselines
+    EntityState roundTrip(const EntityState &state) const;
+    void roundTrip(std::vector<EntityState> &states) const;
+
+    const SnapshotQuantization &getQuantization() const { return quantization; }
+
+private:
+    struct Quantized
+    {
+        uint32_t position[2];
+        uint32_t desired[2];
+        uint32_t health;
+        uint32_t cooldown;
+    };
+
+    Quantized quantize(const EntityState &state) const;
+    static uint32_t changedFields(const Quantized &q, const Quantized &base);
+    size_t fieldBits(UnitKind kind, uint32_t mask) const;
+    void dequantize(const Quantized &q, EntityState &state) const;
+
+    void writeFields(BitWriter &writer, const EntityState &state, const Quantized &q, uint32_t mask) const;
+    void readFields(BitReader &reader, EntityState &state, Quantized &q, uint32_t mask) const;
+
+    SnapshotQuantization quantization;
+    float healthStep;
+    int positionBits;
+    uint32_t positionMaxQ;
+};
@@ -0,0 +1,202 @@
+#include "SnapshotInterpolator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void SnapshotInterpolator::reset()
+{
+    snapshotTicks.fill(0);
+    newest = 0;
+    snapshotCount = 0;
+
+    positions.clear();
+    sampleTicks.clear();
+    slotIds.clear();
+    slotLastTick.clear();
+    freeSlots.clear();
+    slots.clear();
+
+    haveOffset = false;
+    offset = 0.0;
+    jitter = 0.0;
+    interval = 0.05;
+    delay = 0.1;
+
+    frameValid = false;
+    extrapolatedThisFrame = 0;
+    extrapolatedLastFrame = 0;
+}
+
+void SnapshotInterpolator::setTickRate(float ticksPerSecond)
+{
+    if (ticksPerSecond <= 0.f || ticksPerSecond == tickRate)
+        return;
+
+    // ticks already received were spaced at the old rate
+    reset();
+    tickRate = ticksPerSecond;
+}
+
+void SnapshotInterpolator::addSnapshot(uint32_t tick, double receiveTime, const std::vector<EntityState> &states)
+{
+    if (snapshotCount > 0 && tick <= snapshotTicks[newest])
+        return; // late or duplicate, the newer one is already in
+
+    // arrival time relative to the sender's clock; its spread is the jitter the delay has to cover
+    const double sample = receiveTime - (double)tick / tickRate;
+    if (!haveOffset)
+    {
+        offset = sample;
+        haveOffset = true;
+    }
+    else
+    {
+        const double deviation = sample - offset;
+        jitter += (std::fabs(deviation) - jitter) * 0.1;
+        offset += deviation * 0.05;
+
+        interval += ((double)(tick - snapshotTicks[newest]) / tickRate - interval) * 0.1;
+    }
+
+    // one interval to always have a later snapshot to interpolate to, plus room for late ones
+    const double target = std::clamp(interval + 2.0 * jitter, minDelay, maxDelay);
+    delay += (target - delay) * 0.1;
+
+    newest = snapshotCount == 0 ? 0 : (newest + 1) % historySize;
+    snapshotTicks[newest] = tick;
+    snapshotCount = std::min(snapshotCount + 1, historySize);
+
+    for (const EntityState &state : states)
+    {
+        const uint32_t slot = acquireSlot(state.id);
+        positions[slot * historySize + newest] = state.position;
+        sampleTicks[slot * historySize + newest] = tick;
+        slotLastTick[slot] = tick;
+    }
+
+    releaseStaleSlots();
+}
+
+void SnapshotInterpolator::beginFrame(double now)
+{
+    extrapolatedLastFrame = extrapolatedThisFrame;
+    extrapolatedThisFrame = 0;
+
+    frameValid = snapshotCount > 0 && haveOffset;
+    if (!frameValid)
+        return;
+
+    const double renderTick = (now - offset - delay) * tickRate;
+    const size_t oldest = snapshotCount < historySize ? 0 : (newest + 1) % historySize;
+
+    if (renderTick >= (double)snapshotTicks[newest])
+    {
+        // nothing newer arrived in time: continue the last movement briefly, then hold
+        if (snapshotCount < 2)
+        {
+            fromIndex = toIndex = newest;
+            fraction = 0.f;
+            return;
+        }
+        fromIndex = (newest + historySize - 1) % historySize;
+        toIndex = newest;
+
+        const double limit = snapshotTicks[newest] + maxExtrapolation * tickRate;
+        const double from = snapshotTicks[fromIndex];
+        fraction = (float)((std::min(renderTick, limit) - from) / (snapshotTicks[toIndex] - from));
+        return;
+    }
+
+    if (renderTick <= (double)snapshotTicks[oldest])
+    {
+        fromIndex = toIndex = oldest;
+        fraction = 0.f;
+        return;
+    }
+
+    // newest snapshot at or before the render time, and the one after it
+    toIndex = newest;
+    fromIndex = (newest + historySize - 1) % historySize;
+    while (fromIndex != oldest && (double)snapshotTicks[fromIndex] > renderTick)
+    {
+        toIndex = fromIndex;
+        fromIndex = (fromIndex + historySize - 1) % historySize;
+    }
+
+    const double from = snapshotTicks[fromIndex];
+    fraction = (float)((renderTick - from) / (snapshotTicks[toIndex] - from));
+}
+
+bool SnapshotInterpolator::sample(int32_t id, Vector2 &position)
+{
+    if (!frameValid)
+        return false;
+
+    auto it = slots.find(id);
+    if (it == slots.end())
+        return false;
+    const uint32_t slot = it->second;
+
+    const bool hasFrom = hasSample(slot, fromIndex);
+    const bool hasTo = hasSample(slot, toIndex);
+    if (hasFrom && hasTo)
+    {
+        position = Vector2Lerp(positions[slot * historySize + fromIndex], positions[slot * historySize + toIndex], fraction);
+        if (fraction > 1.f)
+            extrapolatedThisFrame++;
+        return true;
+    }
+
+    // spawned or removed in between
+    if (hasTo || hasFrom)
+    {
+        position = positions[slot * historySize + (hasTo ? toIndex : fromIndex)];
+        return true;
+    }
+    return false;
+}
+
+uint32_t SnapshotInterpolator::acquireSlot(int32_t id)
+{
+    auto it = slots.find(id);
+    if (it != slots.end())
+        return it->second;
+
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        // samples left by the previous owner are older than every snapshot in the ring
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        slotIds[slot] = id;
+    }
+    else
+    {
+        slot = (uint32_t)slotIds.size();
+        positions.resize(positions.size() + historySize);
+        sampleTicks.resize(sampleTicks.size() + historySize, UINT32_MAX);
+        slotIds.push_back(id);
+        slotLastTick.push_back(0);
+    }
+
+    slots.emplace(id, slot);
+    return slot;
+}
+
+void SnapshotInterpolator::releaseStaleSlots()
+{
+    if (snapshotCount < historySize)
+        return;
+
+    // not in any snapshot of the ring anymore
+    const uint32_t oldestTick = snapshotTicks[(newest + 1) % historySize];
+    for (uint32_t slot = 0; slot < (uint32_t)slotIds.size(); slot++)
+    {
+        if (slotLastTick[slot] == UINT32_MAX || slotLastTick[slot] >= oldestTick)
+            continue;
+
+        slots.erase(slotIds[slot]);
+        slotLastTick[slot] = UINT32_MAX;
+        freeSlots.push_back(slot);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/Entity.hpp"
+
+// Receiver side of snapshot replication: keeps the last few snapshot positions of every entity and
+// renders them at a time slightly behind the newest snapshot, so jitter in arrival times is hidden.
+// The delay follows the measured snapshot interval and jitter; past the newest snapshot (loss, late
+// packets) positions are extrapolated for a short while.
+//
+// Storage is one ring of snapshot ticks shared by all entities plus per-entity slices of
+// historySize samples in flat arrays; slots are recycled, adding a snapshot does not allocate
+// unless the number of entities grows.
+class SnapshotInterpolator
+{
+public:
+    static constexpr size_t historySize = 8;          // snapshots kept
+    static constexpr double minDelay = 0.02;          // seconds
+    static constexpr double maxDelay = 0.5;
+    static constexpr double maxExtrapolation = 0.15;  // seconds beyond the newest snapshot
+
+    void reset();
+    void setTickRate(float ticksPerSecond); // of the sender, maps ticks to seconds; resets on change
+
+    // `receiveTime` in local seconds
+    void addSnapshot(uint32_t tick, double receiveTime, const std::vector<EntityState> &states);
+
+    // picks the two snapshots around the render time, once per frame before sample()
+    void beginFrame(double now);
+
+    // false if the entity is in neither of those snapshots
+    bool sample(int32_t id, Vector2 &position);
+
+    double getDelay() const { return delay; }
+    double getJitter() const { return jitter; }
+    size_t getExtrapolatedLastFrame() const { return extrapolatedLastFrame; }
+    size_t getTrackedEntities() const { return slots.size(); }
+
+private:
+    uint32_t acquireSlot(int32_t id);
+    void releaseStaleSlots();
+    bool hasSample(uint32_t slot, size_t index) const { return sampleTicks[slot * historySize + index] == snapshotTicks[index]; }
+
+    float tickRate = 60.f;
+
+    std::array<uint32_t, historySize> snapshotTicks{}; // ring, `newest` is the last written
+    size_t newest = 0;
+    size_t snapshotCount = 0;
+
+    // per slot: historySize consecutive entries
+    std::vector<Vector2> positions;
+    std::vector<uint32_t> sampleTicks; // valid when equal to the snapshot tick of the same ring index
+    std::vector<int32_t> slotIds;
+    std::vector<uint32_t> slotLastTick;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<int32_t, uint32_t> slots;
+
+    // sender clock: receiveTime - tick / tickRate, smoothed
+    bool haveOffset = false;
+    double offset = 0.0;
+    double jitter = 0.0;
+    double interval = 0.05; // seconds between snapshots, smoothed
+    double delay = 0.1;
+
+    // this frame
+    size_t fromIndex = 0;
+    size_t toIndex = 0;
+    float fraction = 0.f;     // between from and to, > 1 when extrapolating
+    bool frameValid = false;
+    size_t extrapolatedThisFrame = 0;
+    size_t extrapolatedLastFrame = 0;
+};
@@ -2,6 +2,19 @@
 
 #include "Filesystem.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const std::array<AudioManager::SoundConfig, AudioManager::soundCount> AudioManager::soundConfigs{{
+    {"res/sounds/march.wav", 2, 0.6f, 0},            // March
+    {"res/sounds/artillery_attack.wav", 3, 0.f, 1},  // ArtilleryAttack
+    {"res/sounds/normal_attack.wav", 4, 0.1f, 1},    // NormalAttack
+    {"res/sounds/button_click.wav", 1, 0.05f, 2},    // ButtonClick
+    {"res/sounds/victory.wav", 1, 0.f, 3},           // Victory
+    {"res/sounds/defeat.wav", 1, 0.f, 3},            // Defeat
+}};
+
 AudioManager& AudioManager::getInstance()
 {
     static AudioManager instance;
@@ -12,59 +25,194 @@ void AudioManager::Init(bool playMusic)
 {
     InitAudioDevice();
 
-    musicPlaying = playMusic;
+    musicLoaded = playMusic;
+    musicPlaying = false;
 
     if (playMusic)
     {
         gameMusic = LoadMusicStream(FileSystem::getPath("res/sounds/game_music.mp3").c_str());
-        SetMusicVolume(gameMusic, 0.5f);
+        ::SetMusicVolume(gameMusic, 0.5f);
+    }
+
+    // Load sounds, every voice is an alias sharing the sample data of the base sound
+    std::vector<int> voicesPerSound;
+    for (size_t i = 0; i < soundCount; i++)
+    {
+        sounds[i] = LoadSound(FileSystem::getPath(soundConfigs[i].path).c_str());
+
+        voices[i].clear();
+        for (int v = 0; v < soundConfigs[i].voices; v++)
+            voices[i].push_back(LoadSoundAlias(sounds[i]));
+        voicesPerSound.push_back(soundConfigs[i].voices);
+
+        lastTrigger[i] = -1000.0;
+        requests[i] = Request{};
     }
+    voiceAllocator.init(voicesPerSound, maxActiveVoices);
 
-    // Load sounds
-    sounds[SoundId::March] = LoadSound(FileSystem::getPath("res/sounds/march.wav").c_str());
-    sounds[SoundId::ArtilleryAttack] = LoadSound(FileSystem::getPath("res/sounds/artillery_attack.wav").c_str());
-	sounds[SoundId::NormalAttack] = LoadSound(FileSystem::getPath("res/sounds/normal_attack.wav").c_str());
-	sounds[SoundId::ButtonClick] = LoadSound(FileSystem::getPath("res/sounds/button_click.wav").c_str());
-    sounds[SoundId::Victory] = LoadSound(FileSystem::getPath("res/sounds/victory.wav").c_str());
-    sounds[SoundId::Defeat] = LoadSound(FileSystem::getPath("res/sounds/defeat.wav").c_str());
+    // from here on only the audio thread touches raylib audio
+    audioThreadRunning = true;
+    audioThread = std::thread([this]()
+                              { audioThreadMain(); });
 }
 
 void AudioManager::Update()
 {
-    if (musicPlaying)
+    const double now = GetTime();
+
+    requestsLastUpdate = 0;
+    triggersLastUpdate = 0;
+
+    for (size_t i = 0; i < soundCount; i++)
     {
-        UpdateMusicStream(gameMusic);
+        Request request = requests[i];
+        requests[i] = Request{};
+
+        if (request.count == 0)
+            continue;
+        requestsLastUpdate += request.count;
+
+        const float minInterval = soundConfigs[i].minInterval > 0.f ? soundConfigs[i].minInterval : threshhold;
+        if (now - lastTrigger[i] < minInterval)
+            continue;
+
+        // many units firing at once sound a bit louder, not N times louder
+        const float volume = std::min(1.f, request.volume * (1.f + 0.15f * std::log2((float)request.count)));
+        sendCommand(Command{CommandType::TriggerSound, (uint8_t)i, volume});
+        lastTrigger[i] = now;
+        triggersLastUpdate++;
     }
 }
 
 void AudioManager::Shutdown()
 {
-    for (auto& pair : sounds)
+    audioThreadRunning = false;
+    wakeCondition.notify_one();
+    if (audioThread.joinable())
+        audioThread.join();
+
+    for (size_t i = 0; i < soundCount; i++)
+    {
+        for (Sound &voice : voices[i])
+            UnloadSoundAlias(voice);
+        voices[i].clear();
+
+        UnloadSound(sounds[i]);
+    }
+
+    if (musicLoaded)
     {
-        UnloadSound(pair.second);
+        UnloadMusicStream(gameMusic);
+        musicLoaded = false;
     }
+
     CloseAudioDevice();
 }
 
 void AudioManager::PlayMusic()
 {
-	if (musicPlaying)
-	{
-        PlayMusicStream(gameMusic);
-	}
+    sendCommand(Command{CommandType::PlayMusic, 0, 0.f});
 }
 
 void AudioManager::StopMusic()
 {
-    if (musicPlaying)
-    {
-        StopMusicStream(gameMusic);
-	}
+    sendCommand(Command{CommandType::StopMusic, 0, 0.f});
+}
+
+void AudioManager::SetMusicVolume(float volume)
+{
+    sendCommand(Command{CommandType::MusicVolume, 0, volume});
 }
 
 void AudioManager::Play(SoundId id, float volume)
 {
-    Sound& s = sounds.at(id);
-    SetSoundVolume(s, volume);
-	PlaySound(s);
+    // only recorded here, sent to the audio thread in Update()
+    Request &request = requests[(size_t)id];
+    request.count++;
+    request.volume = std::max(request.volume, volume);
+}
+
+void AudioManager::sendCommand(const Command &command)
+{
+    // never blocks: a full queue drops the command (counted)
+    commands.push(command);
+    wakeCondition.notify_one();
+}
+
+void AudioManager::audioThreadMain()
+{
+    while (audioThreadRunning)
+    {
+        const double now = GetTime();
+
+        Command command;
+        while (commands.pop(command))
+            executeCommand(command, now);
+
+        // keep the music stream buffers filled independent of the game frame rate
+        if (musicPlaying)
+            UpdateMusicStream(gameMusic);
+
+        int playing = 0;
+        for (auto &pool : voices)
+            for (Sound &voice : pool)
+                if (IsSoundPlaying(voice))
+                    playing++;
+        voicesPlaying.store(playing, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait_for(lock, std::chrono::milliseconds(audioThreadPeriodMs), [this]()
+                               { return !audioThreadRunning || commands.size() > 0; });
+    }
+}
+
+void AudioManager::executeCommand(const Command &command, double now)
+{
+    switch (command.type)
+    {
+    case CommandType::TriggerSound:
+    {
+        playVoice(command.sound, command.volume, now);
+        break;
+    }
+    case CommandType::PlayMusic:
+        if (musicLoaded)
+        {
+            PlayMusicStream(gameMusic);
+            musicPlaying = true;
+        }
+        break;
+    case CommandType::StopMusic:
+        if (musicLoaded)
+        {
+            StopMusicStream(gameMusic);
+            musicPlaying = false;
+        }
+        break;
+    case CommandType::MusicVolume:
+        if (musicLoaded)
+            ::SetMusicVolume(gameMusic, command.volume);
+        break;
+    }
+}
+
+void AudioManager::playVoice(size_t sound, float volume, double now)
+{
+    const int priority = soundConfigs[sound].priority;
+    const VoiceAllocator::Choice choice = voiceAllocator.acquire(sound, priority, [this](size_t s, size_t v)
+                                                                 { return IsSoundPlaying(voices[s][v]); });
+    if (!choice.found)
+        return; // everything is busy with more important sounds
+
+    if (choice.steal)
+    {
+        StopSound(voices[choice.victimSound][choice.victimVoice]);
+        voiceAllocator.stop(choice.victimSound, choice.victimVoice);
+    }
+
+    Sound &voice = voices[sound][choice.voice];
+    StopSound(voice);
+    SetSoundVolume(voice, volume);
+    PlaySound(voice);
+    voiceAllocator.start(sound, choice.voice, priority, now);
 }
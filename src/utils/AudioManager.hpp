@@ -1,7 +1,17 @@
 #pragma once
 
 #include <raylib.h>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.hpp"
+#include "VoiceAllocator.hpp"
 
 enum class SoundId { // different sound effects
     March,
@@ -9,9 +19,17 @@ enum class SoundId { // different sound effects
     NormalAttack,
     ButtonClick,
     Victory,
-    Defeat
+    Defeat,
+    Count
 };
 
+// All audio work (music decoding/refill, voice allocation, raylib sound calls) runs on a dedicated audio thread.
+// The game thread only talks to it through a lock-free command queue and never waits on it.
+//
+// Play() only records a request; Update() coalesces all requests of a sound into one trigger per frame,
+// enforces a minimum retrigger interval and sends it to the audio thread, which plays it on a small pool of
+// sound aliases per sound. When all voices are busy the lowest priority (then oldest) voice is stolen, so the
+// cost per frame is bounded by the number of sounds, not by the number of units.
 class AudioManager
 {
 public: 
@@ -24,11 +42,77 @@ public:
     void Play(SoundId id, float volume = 1.0f);
 	void PlayMusic();
     void StopMusic();
+    void SetMusicVolume(float volume);
+
+    int getVoicesPlaying() const { return voicesPlaying.load(std::memory_order_relaxed); }
+    int getRequestsLastUpdate() const { return requestsLastUpdate; }
+    int getTriggersLastUpdate() const { return triggersLastUpdate; }
+    size_t getDroppedCommands() const { return commands.getOverflows(); }
 
 private:
-    std::unordered_map<SoundId, Sound> sounds;
+    static constexpr size_t soundCount = (size_t)SoundId::Count;
+
+    struct SoundConfig
+    {
+        const char *path;
+        int voices;        // aliases in the pool
+        float minInterval; // seconds between two triggers, 0 = use threshhold
+        int priority;      // higher steals lower
+    };
+
+    struct Request
+    {
+        int count = 0;
+        float volume = 0.f; // loudest request wins
+    };
+
+    enum class CommandType : uint8_t
+    {
+        TriggerSound,
+        PlayMusic,
+        StopMusic,
+        MusicVolume
+    };
+
+    struct Command
+    {
+        CommandType type;
+        uint8_t sound;
+        float volume;
+    };
+
+    void sendCommand(const Command &command);
+
+    // audio thread
+    void audioThreadMain();
+    void executeCommand(const Command &command, double now);
+    void playVoice(size_t sound, float volume, double now);
+
+    static const std::array<SoundConfig, soundCount> soundConfigs;
+
+    // game thread
+    std::array<Request, soundCount> requests{};
+    std::array<double, soundCount> lastTrigger{};
+    int requestsLastUpdate = 0;
+    int triggersLastUpdate = 0;
+
+    SpscQueue<Command, 256> commands; // game thread -> audio thread
+
+    std::thread audioThread;
+    std::atomic<bool> audioThreadRunning{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    const int audioThreadPeriodMs = 5; // music refill and command latency bound
+
+    // owned by the audio thread while it runs
+    std::array<Sound, soundCount> sounds{};
+    std::array<std::vector<Sound>, soundCount> voices; // aliases of sounds[i]
+    VoiceAllocator voiceAllocator;
+    const int maxActiveVoices = 8; // across all sounds, fewer than the pools hold together so that stealing happens
+    std::atomic<int> voicesPlaying{0};
 
     Music gameMusic;
+    bool musicLoaded = false;
     bool musicPlaying = false;
 
     const float threshhold = 0.3f; // minimum time between same sound plays
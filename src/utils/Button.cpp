@@ -91,20 +91,20 @@ void Button::draw()
     DrawTextureRec(texture, sourceRec, Vector2{btnBounds.x, btnBounds.y}, WHITE); // Draw button frame
 }
 
-void Button::update(Vector2 mousePos)
+void Button::update(const InputState &input)
 {
     if (!initialized)
         return;
     Rectangle rect = {position.x, position.y, static_cast<float>(texture.width), static_cast<float>(frameHeight)};
 
-    if (CheckCollisionPointRec(mousePos, rect))
+    if (CheckCollisionPointRec(input.mousePos, rect))
     {
-        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+        if (input.mouseLeftDown)
             btnState = 2;
         else
             btnState = 1;
 
-        if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+        if (input.mouseLeftReleased)
             btnAction = true;
     }
     else
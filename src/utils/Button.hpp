@@ -1,6 +1,8 @@
 #pragma once
 #include <raylib.h>
 
+#include "InputState.hpp"
+
 class Button
 {
 public:
@@ -15,7 +17,7 @@ public:
 
     void init(const char *imagePath, Vector2 imagePosition, float scale);
     void draw();
-    void update(Vector2 mousePos);
+    void update(const InputState &input);
 
     inline bool isPressed()
     {
@@ -0,0 +1,87 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::init(int width, int height, float targetFrameMs)
+{
+    shutdown();
+
+    this->width = width;
+    this->height = height;
+    this->targetFrameMs = targetFrameMs;
+
+    target = LoadRenderTexture(width, height);
+    SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+
+    smoothedFrameMs = targetFrameMs;
+    framesSinceChange = 0;
+}
+
+void DynamicResolution::shutdown()
+{
+    if (target.id != 0)
+    {
+        UnloadRenderTexture(target);
+        target = RenderTexture2D{};
+    }
+}
+
+void DynamicResolution::update(float workTime)
+{
+    smoothedFrameMs += (workTime * 1000.f - smoothedFrameMs) * 0.1f;
+
+    if (mode != Mode::Auto)
+        return;
+
+    if (++framesSinceChange < settleFrames)
+        return;
+
+    float newScale = scale;
+    if (smoothedFrameMs > targetFrameMs * downThreshold)
+        newScale = scale - scaleStep;
+    else if (smoothedFrameMs <= targetFrameMs * upThreshold)
+        newScale = scale + scaleStep;
+
+    newScale = std::clamp(newScale, minScale, maxScale);
+    if (std::fabs(newScale - scale) > 0.001f)
+    {
+        scale = newScale;
+        framesSinceChange = 0;
+    }
+}
+
+void DynamicResolution::setAuto()
+{
+    mode = Mode::Auto;
+    framesSinceChange = 0;
+}
+
+void DynamicResolution::setFixedScale(float fixedScale)
+{
+    mode = Mode::Fixed;
+    scale = std::clamp(fixedScale, minScale, maxScale);
+}
+
+void DynamicResolution::beginScene() const
+{
+    BeginTextureMode(target);
+    ClearBackground(WHITE);
+}
+
+void DynamicResolution::endScene() const
+{
+    EndTextureMode();
+}
+
+void DynamicResolution::present() const
+{
+    const float sceneWidth = (float)getSceneWidth();
+    const float sceneHeight = (float)getSceneHeight();
+
+    // render textures are stored bottom-up: the scene occupies the top rows, negative height flips it
+    Rectangle source = {0.f, (float)height - sceneHeight, sceneWidth, -sceneHeight};
+    Rectangle dest = {0.f, 0.f, (float)width, (float)height};
+
+    DrawTexturePro(target.texture, source, dest, {0.f, 0.f}, 0.f, WHITE);
+}
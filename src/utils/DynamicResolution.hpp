@@ -0,0 +1,51 @@
+#pragma once
+#include <raylib.h>
+
+// Renders the scene into an offscreen target whose used area scales with the measured frame work time,
+// then upscales it to the window. The target is allocated once at full size, lowering the scale only
+// shrinks the area that gets rasterized, so scale changes never reallocate.
+class DynamicResolution
+{
+public:
+    enum class Mode
+    {
+        Auto,
+        Fixed // for benchmarking
+    };
+
+    void init(int width, int height, float targetFrameMs);
+    void shutdown();
+
+    void update(float workTime); // seconds of rendering and simulation work, no waits; adjusts the scale in auto mode
+
+    void setAuto();
+    void setFixedScale(float fixedScale);
+
+    void beginScene() const; // everything until endScene() goes into the offscreen target
+    void endScene() const;
+    void present() const; // upscaled blit to the current framebuffer
+
+    float getScale() const { return scale; }
+    Mode getMode() const { return mode; }
+    int getSceneWidth() const { return (int)(width * scale); }
+    int getSceneHeight() const { return (int)(height * scale); }
+
+private:
+    RenderTexture2D target{};
+    int width = 0;
+    int height = 0;
+
+    Mode mode = Mode::Auto;
+    float scale = 1.f;
+
+    float targetFrameMs = 1000.f / 60.f;
+    float smoothedFrameMs = 0.f;
+    int framesSinceChange = 0;
+
+    const float minScale = 0.5f;
+    const float maxScale = 1.f;
+    const float scaleStep = 0.05f;
+    const int settleFrames = 30;         // frames to wait after a change before judging again
+    const float downThreshold = 1.10f;   // over budget by 10% -> lower resolution
+    const float upThreshold = 1.02f;     // back within budget -> raise resolution
+};
@@ -0,0 +1,215 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+void PercentileWindow::add(float value)
+{
+    samples[next] = value;
+    next = (next + 1) % samples.size();
+    count = std::min(count + 1, samples.size());
+}
+
+float PercentileWindow::percentile(float p) const
+{
+    if (count == 0)
+        return 0.f;
+
+    std::copy(samples.begin(), samples.begin() + count, scratch.begin());
+    const size_t index = std::min(count - 1, (size_t)std::ceil(p * (float)count) - (p > 0.f ? 1 : 0));
+    std::nth_element(scratch.begin(), scratch.begin() + index, scratch.begin() + count);
+    return scratch[index];
+}
+
+void FramePacer::init(int targetFps, PacingMode mode)
+{
+    framePeriod = 1.0 / (double)targetFps;
+    lastPresent = GetTime();
+    nextDeadline = lastPresent + framePeriod;
+    lastPollTime = lastPresent;
+    lastReport = lastPresent;
+
+    this->mode = mode;
+    applyMode();
+}
+
+void FramePacer::setMode(PacingMode newMode)
+{
+    if (newMode == mode)
+        return;
+
+    mode = newMode;
+    applyMode();
+}
+
+void FramePacer::applyMode()
+{
+    // raylib's own wait is always off, pacing happens here
+    SetTargetFPS(0);
+    if (mode == PacingMode::VSync)
+        SetWindowState(FLAG_VSYNC_HINT);
+    else
+        ClearWindowState(FLAG_VSYNC_HINT);
+
+    frameTimes.clear();
+    latencies.clear();
+    report = Report{};
+    workEstimate = 0.f;
+    workDeviation = 0.f;
+    nextDeadline = GetTime() + framePeriod;
+}
+
+const char *FramePacer::modeName(PacingMode mode)
+{
+    switch (mode)
+    {
+    case PacingMode::LowLatency:
+        return "low latency";
+    case PacingMode::PowerSave:
+        return "power save";
+    case PacingMode::VSync:
+        return "vsync";
+    }
+    return "";
+}
+
+void FramePacer::beginFrame()
+{
+    if (mode == PacingMode::LowLatency)
+    {
+        // wake up just in time to finish the frame before the deadline, then sample input
+        const double wake = nextDeadline - (double)(workEstimate + 2.f * workDeviation) - lowLatencyMargin;
+        sleepUntil(wake, true);
+
+        PollInputEvents();
+        sampleInput();
+    }
+
+    inputSampleTime = lastPollTime;
+    workStart = GetTime();
+}
+
+void FramePacer::beginPresent()
+{
+    presentStart = GetTime();
+}
+
+InputState FramePacer::takeInput()
+{
+    InputState input = pendingInput;
+    pendingInput = InputState{};
+
+    // levels are read at the time of the latest poll
+    input.mousePos = GetMousePosition();
+    input.mouseLeftDown = IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+    input.mouseRightDown = IsMouseButtonDown(MOUSE_BUTTON_RIGHT);
+
+    consumedEventTime = input.eventTime;
+    return input;
+}
+
+void FramePacer::endFrame()
+{
+    // EndDrawing() swapped and polled input just now
+    const double present = GetTime();
+    sampleInput();
+
+    frameTimes.add((float)((present - lastPresent) * 1000.0));
+    lastPresent = present;
+    workTime = (float)((mode == PacingMode::VSync ? presentStart : present) - workStart);
+
+    if (consumedEventTime >= 0.0)
+    {
+        latencies.add((float)((present - consumedEventTime) * 1000.0));
+        consumedEventTime = -1.0;
+    }
+
+    if (mode == PacingMode::LowLatency)
+    {
+        // time from the late input sample to the present, with a slow decay so spikes are respected
+        const float work = (float)(present - inputSampleTime);
+        workDeviation += (std::fabs(work - workEstimate) - workDeviation) * 0.1f;
+        workEstimate += (work - workEstimate) * (work > workEstimate ? 0.5f : 0.05f);
+    }
+
+    // next deadline on the frame grid; resync after missed frames instead of bursting to catch up
+    nextDeadline += framePeriod;
+    if (nextDeadline < present)
+        nextDeadline = present + framePeriod;
+
+    if (mode == PacingMode::PowerSave)
+        sleepUntil(nextDeadline, false);
+
+    updateReport(present);
+}
+
+void FramePacer::sampleInput()
+{
+    // raylib/GLFW have no event timestamps: an edge happened somewhere between the previous poll
+    // and this one, the midpoint is the expected arrival time
+    const double now = GetTime();
+    const double estimatedEventTime = (lastPollTime + now) * 0.5;
+    lastPollTime = now;
+
+    bool anyEdge = false;
+
+    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+    {
+        pendingInput.mouseLeftPressed = true;
+        anyEdge = true;
+    }
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+    {
+        pendingInput.mouseLeftReleased = true;
+        anyEdge = true;
+    }
+
+    for (size_t i = 0; i < InputState::trackedKeys.size(); i++)
+    {
+        if (IsKeyPressed(InputState::trackedKeys[i]))
+        {
+            pendingInput.keysPressed |= 1u << i;
+            anyEdge = true;
+        }
+    }
+
+    const Vector2 delta = GetMouseDelta();
+    pendingInput.mouseDelta.x += delta.x;
+    pendingInput.mouseDelta.y += delta.y;
+    pendingInput.mouseWheel += GetMouseWheelMove();
+
+    if (anyEdge && pendingInput.eventTime < 0.0)
+        pendingInput.eventTime = estimatedEventTime;
+}
+
+void FramePacer::sleepUntil(double time, bool spinTail) const
+{
+    // OS sleep for the bulk, the last millisecond is spent yielding when precision matters
+    const double tail = spinTail ? 0.001 : 0.0;
+
+    double remaining = time - GetTime();
+    if (remaining > tail)
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - tail));
+
+    if (spinTail)
+    {
+        while (GetTime() < time)
+            std::this_thread::yield();
+    }
+}
+
+void FramePacer::updateReport(double now)
+{
+    if (now - lastReport < 1.0)
+        return;
+    lastReport = now;
+
+    report.frameP50 = frameTimes.percentile(0.5f);
+    report.frameP99 = frameTimes.percentile(0.99f);
+    report.frameP999 = frameTimes.percentile(0.999f);
+    report.latencyP50 = latencies.percentile(0.5f);
+    report.latencyP99 = latencies.percentile(0.99f);
+    report.latencySamples = latencies.size();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <raylib.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "InputState.hpp"
+
+enum class PacingMode
+{
+    LowLatency, // sleep first, then sample input as late as possible before the simulation
+    PowerSave,  // sample input, work, then sleep until the next frame
+    VSync       // let the swap block on the display
+};
+
+// sliding window of samples for percentile reports
+class PercentileWindow
+{
+public:
+    explicit PercentileWindow(size_t capacity) : samples(capacity, 0.f), scratch(capacity, 0.f) {}
+
+    void add(float value);
+    void clear() { count = 0; next = 0; }
+    size_t size() const { return count; }
+    float percentile(float p) const; // p in [0, 1]
+
+private:
+    std::vector<float> samples;
+    mutable std::vector<float> scratch;
+    size_t count = 0;
+    size_t next = 0;
+};
+
+// Frame pacing and input sampling. Call beginFrame() before reading input and endFrame() right after EndDrawing().
+class FramePacer
+{
+public:
+    struct Report
+    {
+        float frameP50 = 0.f; // ms
+        float frameP99 = 0.f;
+        float frameP999 = 0.f;
+        float latencyP50 = 0.f; // input event to present, ms
+        float latencyP99 = 0.f;
+        size_t latencySamples = 0;
+    };
+
+    FramePacer() : frameTimes(frameWindow), latencies(latencyWindow) {}
+
+    void init(int targetFps, PacingMode mode);
+    void setMode(PacingMode newMode);
+    PacingMode getMode() const { return mode; }
+    static const char *modeName(PacingMode mode);
+
+    void beginFrame();       // low latency: sleeps, then polls input late
+    InputState takeInput();  // input accumulated since the last frame
+    void beginPresent();     // right before EndDrawing()
+    void endFrame();         // records the present, power save: sleeps until the next frame
+
+    // seconds the last frame spent working, without any pacing sleep; in vsync mode the swap is left
+    // out as well, since it mostly waits for the display
+    float getWorkTime() const { return workTime; }
+
+    const Report &getReport() const { return report; } // refreshed once per second
+
+private:
+    void applyMode();
+    void sampleInput(); // after every PollInputEvents()
+    void sleepUntil(double time, bool spinTail) const;
+    void updateReport(double now);
+
+    PacingMode mode = PacingMode::PowerSave;
+    double framePeriod = 1.0 / 60.0;
+
+    double lastPresent = 0.0;
+    double nextDeadline = 0.0;
+    double inputSampleTime = 0.0; // last input poll of this frame
+    double workStart = 0.0;       // beginFrame() done
+    double presentStart = 0.0;
+    float workTime = 0.f;
+    double lastPollTime = 0.0;
+
+    float workEstimate = 0.f; // seconds from late input sample to present, smoothed with headroom
+    float workDeviation = 0.f;
+
+    InputState pendingInput;
+    double consumedEventTime = -1.0;
+
+    static constexpr size_t frameWindow = 4096;
+    static constexpr size_t latencyWindow = 1024;
+    PercentileWindow frameTimes;
+    PercentileWindow latencies;
+    Report report;
+    double lastReport = 0.0;
+
+    const double lowLatencyMargin = 0.0005; // extra headroom before the deadline
+};
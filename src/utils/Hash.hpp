@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, cheap and good enough to notice diverging simulation state
+constexpr uint32_t fnvOffsetBasis = 2166136261u;
+
+inline uint32_t fnv1a(const void *data, size_t size, uint32_t hash = fnvOffsetBasis)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <typename T>
+inline uint32_t fnv1aValue(const T &value, uint32_t hash)
+{
+    return fnv1a(&value, sizeof(T), hash);
+}
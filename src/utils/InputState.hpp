@@ -0,0 +1,36 @@
+#pragma once
+#include <raylib.h>
+
+#include <array>
+#include <cstdint>
+
+// Input of one frame. Edges (pressed/released), wheel and mouse delta are accumulated over
+// every PollInputEvents() since the last frame, so late input sampling does not lose them.
+struct InputState
+{
+    // keys whose pressed edge is tracked, raylib forgets edges on the next poll
+    static constexpr std::array<int, 13> trackedKeys{{KEY_ONE, KEY_TWO, KEY_THREE, KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_HOME}};
+
+    Vector2 mousePos{0.f, 0.f};
+    Vector2 mouseDelta{0.f, 0.f};
+    float mouseWheel = 0.f;
+
+    bool mouseLeftPressed = false;
+    bool mouseLeftReleased = false;
+    bool mouseLeftDown = false;
+    bool mouseRightDown = false;
+
+    uint32_t keysPressed = 0; // one bit per tracked key
+
+    double eventTime = -1.0; // estimated time of the earliest edge in this frame, -1 if there was none
+
+    bool keyPressed(int key) const
+    {
+        for (size_t i = 0; i < trackedKeys.size(); i++)
+        {
+            if (trackedKeys[i] == key)
+                return (keysPressed >> i) & 1u;
+        }
+        return false;
+    }
+};
@@ -24,4 +24,79 @@ struct PacketData
     int desiredPos[2];
 };
 
+// every ENet packet starts with a frame header, followed by `count` records of the given type
+enum class MessageType : uint8_t
+{
+    Commands = 1, // PacketData records issued during one simulation tick
+    Config = 2,   // host -> client, no records, followed by ConfigMessage fields
+    Snapshot = 3,   // host -> client, delta compressed entity state, unreliable channel
+    SnapshotAck = 4, // client -> host, no records, tick = newest snapshot decoded (the next baseline)
+    Checksum = 5,    // lockstep, both ways: count uint32 state hashes of the ticks ending at `tick`
+    Resync = 6       // host -> client that (re)joined mid-match, reliable: one chunk of the full state, count = chunk index
+};
+
+// how the two peers keep their simulations in step; chosen by the host
+enum class NetMode : uint8_t
+{
+    Independent = 0,   // both simulate, only spawns and orders are exchanged
+    Authoritative = 1, // host simulates and replicates state, the client only renders it
+    Lockstep = 2,      // both simulate, a tick only runs once both peers' commands for it are known
+    Rollback = 3       // like lockstep, but missing commands are predicted and corrected by re-simulating
+};
+
+// ENet channels
+constexpr uint8_t reliableChannel = 0; // commands, config
+constexpr uint8_t snapshotChannel = 1; // unreliable sequenced, late snapshots are dropped by ENet
+
+struct FrameHeader
+{
+    MessageType type;
+    uint16_t count;
+    uint32_t tick; // simulation tick of the sender
+};
+
+constexpr size_t maxCommandsPerFrame = 64; // larger group orders are split over several frames
+
+// fixed capacity so frames can be queued between threads without allocating
+struct CommandFrame
+{
+    FrameHeader header;
+    PacketData commands[maxCommandsPerFrame];
+
+    size_t byteSize() const { return sizeof(FrameHeader) + header.count * sizeof(PacketData); }
+};
+
+struct ConfigMessage
+{
+    FrameHeader header;
+    NetMode mode;
+    uint8_t simRateIndex; // lockstep and rollback: both peers have to step with the same dt
+    uint8_t spectator;    // 1: the host already has a player, this peer only watches (always a replica)
+    uint8_t resync;       // 1: the match is running, its state follows in Resync chunks; no ticks before it is in
+};
+
+struct ResyncChunk
+{
+    FrameHeader header;  // tick = the tick of the state, count = chunk index; followed by the chunk's bytes
+    uint16_t chunkCount;
+    uint32_t totalSize;  // bytes of the whole state
+};
+
+// the state Resync chunks add up to; followed by a full SnapshotCodec snapshot, one halted bit per entity
+// in id order (the codec does not replicate it, lockstep needs it) and the host's tick frames for the
+// first ticks after the state (lockstep and rollback, sent before the player was back)
+struct ResyncState
+{
+    float damageBank[2];
+    uint32_t entityCount;
+    uint32_t snapshotBytes;
+    uint8_t frameCount;
+};
+
+struct SnapshotHeader
+{
+    FrameHeader header;      // count = number of entities in the snapshot, followed by the SnapshotCodec payload
+    int32_t clientCurrency;  // the host keeps the client's currency in authoritative mode
+};
+
 #pragma pack(pop)
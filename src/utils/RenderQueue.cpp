@@ -0,0 +1,113 @@
+#include "RenderQueue.hpp"
+
+#include <array>
+#include <climits>
+
+void RenderQueue::drawTexture(RenderLayer layer, Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, Color tint, uint8_t subLayer)
+{
+    push(layer, subLayer, Primitive::Texture, texture.id, RenderCommand{Primitive::Texture, texture, source, dest, origin, tint, 0.f});
+}
+
+void RenderQueue::drawRectangle(RenderLayer layer, Rectangle rec, Color color, uint8_t subLayer)
+{
+    push(layer, subLayer, Primitive::Rectangle, 0, RenderCommand{Primitive::Rectangle, Texture2D{}, Rectangle{}, rec, Vector2{}, color, 0.f});
+}
+
+void RenderQueue::drawRectangleLines(RenderLayer layer, Rectangle rec, float thickness, Color color, uint8_t subLayer)
+{
+    push(layer, subLayer, Primitive::RectangleLines, 0, RenderCommand{Primitive::RectangleLines, Texture2D{}, Rectangle{}, rec, Vector2{}, color, thickness});
+}
+
+void RenderQueue::drawCircle(RenderLayer layer, Vector2 center, float radius, Color color, uint8_t subLayer)
+{
+    push(layer, subLayer, Primitive::Circle, 0, RenderCommand{Primitive::Circle, Texture2D{}, Rectangle{}, {center.x, center.y, radius, radius}, Vector2{}, color, 0.f});
+}
+
+void RenderQueue::push(RenderLayer layer, uint8_t subLayer, Primitive primitive, unsigned int textureId, const RenderCommand &command)
+{
+    const uint64_t key = ((uint64_t)((uint8_t)layer & 0xF) << 60) |
+                         ((uint64_t)(subLayer & 0xF) << 56) |
+                         ((uint64_t)((uint8_t)primitive & 0xF) << 52) |
+                         ((uint64_t)(textureId & 0xFFFFF) << 32) |
+                         (uint64_t)(uint32_t)commands.size();
+
+    keys.push_back(key);
+    commands.push_back(command);
+}
+
+void RenderQueue::radixSort()
+{
+    // LSD radix sort, 8 bits per pass; passes where every key has the same byte are skipped
+    scratch.resize(keys.size());
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> counts{};
+        for (uint64_t key : keys)
+            counts[(key >> shift) & 0xFF]++;
+
+        if (counts[(keys.front() >> shift) & 0xFF] == keys.size())
+            continue;
+
+        size_t offset = 0;
+        for (size_t &count : counts)
+        {
+            const size_t c = count;
+            count = offset;
+            offset += c;
+        }
+
+        for (uint64_t key : keys)
+            scratch[counts[(key >> shift) & 0xFF]++] = key;
+
+        keys.swap(scratch);
+    }
+}
+
+void RenderQueue::flush()
+{
+    commandsLastFlush = commands.size();
+    batchesLastFlush = 0;
+
+    if (commands.empty())
+        return;
+
+    radixSort();
+
+    // a batch breaks whenever the texture or the vertex mode changes (shapes use quads, circles triangles)
+    unsigned int currentTexture = UINT_MAX;
+    int currentMode = -1;
+
+    for (uint64_t key : keys)
+    {
+        const RenderCommand &cmd = commands[(uint32_t)key];
+
+        const unsigned int texture = cmd.primitive == Primitive::Texture ? cmd.texture.id : 0;
+        const int mode = cmd.primitive == Primitive::Circle ? 1 : 0;
+        if (texture != currentTexture || mode != currentMode)
+        {
+            batchesLastFlush++;
+            currentTexture = texture;
+            currentMode = mode;
+        }
+
+        switch (cmd.primitive)
+        {
+        case Primitive::Texture:
+            DrawTexturePro(cmd.texture, cmd.source, cmd.dest, cmd.origin, 0.f, cmd.color);
+            break;
+        case Primitive::Rectangle:
+            DrawRectangleRec(cmd.dest, cmd.color);
+            break;
+        case Primitive::RectangleLines:
+            DrawRectangleLinesEx(cmd.dest, cmd.thickness, cmd.color);
+            break;
+        case Primitive::Circle:
+            DrawCircleV({cmd.dest.x, cmd.dest.y}, cmd.dest.width, cmd.color);
+            break;
+        }
+    }
+
+    commands.clear();
+    keys.clear();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <raylib.h>
+
+#include <cstdint>
+#include <vector>
+
+enum class RenderLayer : uint8_t
+{
+    Background = 0,
+    Bases = 1, // under the units that walk over them, whatever their textures
+    Units = 2,
+    HealthBars = 3
+};
+
+enum class Primitive : uint8_t
+{
+    Texture = 0,
+    Rectangle = 1,
+    RectangleLines = 2,
+    Circle = 3
+};
+
+// Draw calls are recorded with a sort key and issued in one go on flush().
+// Sorting groups commands by layer, sub layer, primitive and texture so rlgl can batch them:
+// [ 4 bits layer ][ 4 bits sub layer ][ 4 bits primitive ][ 20 bits texture id ][ 32 bits command index ]
+// the command index keeps the recording order for equal keys.
+class RenderQueue
+{
+public:
+    void drawTexture(RenderLayer layer, Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, Color tint, uint8_t subLayer = 0);
+    void drawRectangle(RenderLayer layer, Rectangle rec, Color color, uint8_t subLayer = 0);
+    void drawRectangleLines(RenderLayer layer, Rectangle rec, float thickness, Color color, uint8_t subLayer = 0);
+    void drawCircle(RenderLayer layer, Vector2 center, float radius, Color color, uint8_t subLayer = 0);
+
+    // sort and issue all recorded commands, then clear the queue
+    void flush();
+
+    int getBatchesLastFlush() const { return batchesLastFlush; }
+    size_t getCommandsLastFlush() const { return commandsLastFlush; }
+
+private:
+    struct RenderCommand
+    {
+        Primitive primitive;
+        Texture2D texture;
+        Rectangle source;
+        Rectangle dest; // for circles: x, y = center, width = radius
+        Vector2 origin;
+        Color color;
+        float thickness;
+    };
+
+    void push(RenderLayer layer, uint8_t subLayer, Primitive primitive, unsigned int textureId, const RenderCommand &command);
+    void radixSort();
+
+    std::vector<RenderCommand> commands;
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> scratch; // radix sort ping-pong buffer, kept between frames
+
+    int batchesLastFlush = 0;
+    size_t commandsLastFlush = 0;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// uniform grid over the battlefield for fast area queries (view culling).
+// items stay in the grid between frames: update() only touches cells when an item moves into other
+// cells, remove() takes it out for good. Items outside the grid are clamped into the border cells.
+template <typename T>
+class SpatialGrid
+{
+public:
+    SpatialGrid(float width, float height, float cellSize)
+        : cellSize(cellSize),
+          cols(std::max(1, (int)std::ceil(width / cellSize))),
+          rows(std::max(1, (int)std::ceil(height / cellSize))),
+          cells((size_t)(cols * rows))
+    {
+    }
+
+    void clear()
+    {
+        for (auto &cell : cells)
+            cell.clear(); // keeps capacity
+        slots.clear();
+    }
+
+    // inserts the item, or moves it when its bounds now cover other cells
+    void update(const T &item, Rectangle bounds)
+    {
+        const CellRange range = cellRange(bounds);
+        auto [it, inserted] = slots.try_emplace(item, Slot{item, range, 0});
+        Slot &slot = it->second;
+        if (!inserted)
+        {
+            if (slot.range == range)
+                return; // still in the same cells, the common case
+            unlink(slot);
+            slot.range = range;
+        }
+        link(slot);
+    }
+
+    void remove(const T &item)
+    {
+        auto it = slots.find(item);
+        if (it == slots.end())
+            return;
+        unlink(it->second);
+        slots.erase(it);
+    }
+
+    bool contains(const T &item) const { return slots.count(item) != 0; }
+    size_t size() const { return slots.size(); }
+
+    // calls fn(item) once for every item whose cells overlap the area
+    template <typename Fn>
+    void query(Rectangle area, Fn &&fn)
+    {
+        if (++queryStamp == 0) // wrapped around, reset stamps
+        {
+            for (auto &entry : slots)
+                entry.second.stamp = 0;
+            queryStamp = 1;
+        }
+
+        const CellRange range = cellRange(area);
+        for (int y = range.y0; y <= range.y1; y++)
+        {
+            for (int x = range.x0; x <= range.x1; x++)
+            {
+                for (Slot *slot : cells[(size_t)(y * cols + x)])
+                {
+                    if (slot->stamp == queryStamp)
+                        continue;
+                    slot->stamp = queryStamp;
+                    fn(slot->item);
+                }
+            }
+        }
+    }
+
+private:
+    struct CellRange
+    {
+        int x0, y0, x1, y1;
+        bool operator==(const CellRange &other) const { return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1; }
+    };
+
+    struct Slot
+    {
+        T item;
+        CellRange range;
+        uint32_t stamp; // last query that visited the item, avoids duplicates
+    };
+
+    CellRange cellRange(Rectangle r) const
+    {
+        return CellRange{std::clamp((int)std::floor(r.x / cellSize), 0, cols - 1), std::clamp((int)std::floor(r.y / cellSize), 0, rows - 1),
+                         std::clamp((int)std::floor((r.x + r.width) / cellSize), 0, cols - 1), std::clamp((int)std::floor((r.y + r.height) / cellSize), 0, rows - 1)};
+    }
+
+    void link(Slot &slot)
+    {
+        for (int y = slot.range.y0; y <= slot.range.y1; y++)
+            for (int x = slot.range.x0; x <= slot.range.x1; x++)
+                cells[(size_t)(y * cols + x)].push_back(&slot);
+    }
+
+    void unlink(Slot &slot)
+    {
+        for (int y = slot.range.y0; y <= slot.range.y1; y++)
+        {
+            for (int x = slot.range.x0; x <= slot.range.x1; x++)
+            {
+                std::vector<Slot *> &cell = cells[(size_t)(y * cols + x)];
+                auto it = std::find(cell.begin(), cell.end(), &slot);
+                if (it == cell.end())
+                    continue;
+                *it = cell.back(); // order within a cell does not matter
+                cell.pop_back();
+            }
+        }
+    }
+
+    float cellSize;
+    int cols;
+    int rows;
+
+    std::vector<std::vector<Slot *>> cells; // slots live in the map, whose nodes do not move
+    std::unordered_map<T, Slot> slots;
+    uint32_t queryStamp = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free single producer / single consumer ring buffer.
+// push() is only called by the producer thread, pop() only by the consumer thread.
+// No allocations after construction; a full queue rejects the item and counts the overflow.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    bool push(const T &item)
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        buffer[tail & (Capacity - 1)] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire))
+            return false;
+
+        item = buffer[head & (Capacity - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side, in-place variant of push(): fill the returned slot, then endPush().
+    // nullptr (counted as overflow) when full.
+    T *beginPush()
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &buffer[tail & (Capacity - 1)];
+    }
+
+    void endPush()
+    {
+        tailIndex.store(tailIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer side, in-place variant of pop(): read the front slot, then popFront()
+    T *front()
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire))
+            return nullptr;
+        return &buffer[head & (Capacity - 1)];
+    }
+
+    void popFront()
+    {
+        headIndex.store(headIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer side: drops everything currently queued
+    void clear()
+    {
+        headIndex.store(tailIndex.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // approximate when read from a third thread
+    size_t size() const
+    {
+        return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+    }
+
+    size_t getOverflows() const { return overflows.load(std::memory_order_relaxed); }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> headIndex{0};
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    alignas(64) std::atomic<size_t> overflows{0};
+    std::array<T, Capacity> buffer{};
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <raylib.h>
+
+#include <string>
+#include <unordered_map>
+
+// reference counted textures shared by all entities of a kind;
+// one GPU texture per file instead of one per unit, which also lets the render queue batch them
+class TextureCache
+{
+public:
+    static TextureCache &getInstance()
+    {
+        static TextureCache instance;
+        return instance;
+    }
+
+    Texture2D load(const std::string &path)
+    {
+        auto it = byPath.find(path);
+        if (it == byPath.end())
+        {
+            Texture2D texture = LoadTexture(path.c_str());
+            it = byPath.emplace(path, Entry{texture, 0}).first;
+            pathById[texture.id] = path;
+        }
+
+        it->second.refCount++;
+        return it->second.texture;
+    }
+
+    void unload(Texture2D texture)
+    {
+        auto path = pathById.find(texture.id);
+        if (path == pathById.end())
+            return;
+
+        auto it = byPath.find(path->second);
+        if (--it->second.refCount > 0)
+            return;
+
+        UnloadTexture(it->second.texture);
+        byPath.erase(it);
+        pathById.erase(path);
+    }
+
+private:
+    TextureCache() = default;
+
+    struct Entry
+    {
+        Texture2D texture;
+        int refCount;
+    };
+
+    std::unordered_map<std::string, Entry> byPath;
+    std::unordered_map<unsigned int, std::string> pathById;
+};
@@ -0,0 +1,319 @@
+#include "TileStreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+TileStreamer::~TileStreamer()
+{
+    shutdown();
+}
+
+void TileStreamer::init(const std::string &sourcePath, const std::string &tileDirectory, const std::string &cacheDirectory, Vector2 mapSize, float tileSize, size_t budgetBytes)
+{
+    shutdown();
+
+    this->sourcePath = sourcePath;
+    this->tileDirectory = tileDirectory;
+    this->cacheDirectory = cacheDirectory + "/" + std::to_string((int)tileSize);
+    this->mapSize = mapSize;
+    this->tileSize = tileSize;
+    this->budgetBytes = budgetBytes;
+
+    cols = std::max(1, (int)std::ceil(mapSize.x / tileSize));
+    rows = std::max(1, (int)std::ceil(mapSize.y / tileSize));
+
+    tilesCut = false;
+    stopWorker = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        requests.push_back(previewKey); // preview first, so there is always something to draw
+    }
+    pending.insert(previewKey);
+
+    worker = std::thread([this]()
+                         { workerMain(); });
+}
+
+void TileStreamer::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopWorker = true;
+    }
+    queueCondition.notify_all();
+    if (worker.joinable())
+        worker.join();
+
+    // images finished but never uploaded
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (auto &loaded : ready)
+            UnloadImage(loaded.image);
+        ready.clear();
+        requests.clear();
+    }
+    pending.clear();
+
+    for (auto &[key, tile] : resident)
+        UnloadTexture(tile.texture);
+    resident.clear();
+    lruOrder.clear();
+    residentBytes = 0;
+
+    if (preview.id != 0)
+    {
+        UnloadTexture(preview);
+        preview = Texture2D{};
+    }
+}
+
+void TileStreamer::update(Rectangle visibleArea)
+{
+    // tiles on screen plus a prefetch ring around them
+    int x0, y0, x1, y1;
+    tileRange(visibleArea, x0, y0, x1, y1);
+    x0 = std::max(x0 - prefetchRing, 0);
+    y0 = std::max(y0 - prefetchRing, 0);
+    x1 = std::min(x1 + prefetchRing, cols - 1);
+    y1 = std::min(y1 + prefetchRing, rows - 1);
+
+    std::unordered_set<TileKey> wanted;
+    std::vector<TileKey> missing;
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            const TileKey key = makeKey(x, y);
+            wanted.insert(key);
+
+            auto it = resident.find(key);
+            if (it != resident.end())
+            {
+                lruOrder.splice(lruOrder.begin(), lruOrder, it->second.lru); // touch
+            }
+            else if (pending.find(key) == pending.end())
+            {
+                missing.push_back(key);
+                pending.insert(key);
+            }
+        }
+    }
+
+    std::vector<LoadedImage> uploads;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        // drop requests that scrolled out of range before the worker got to them
+        for (auto it = requests.begin(); it != requests.end();)
+        {
+            if (*it != previewKey && wanted.find(*it) == wanted.end())
+            {
+                pending.erase(*it);
+                it = requests.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        requests.insert(requests.end(), missing.begin(), missing.end());
+
+        const size_t count = std::min(ready.size(), (size_t)maxUploadsPerFrame);
+        uploads.assign(ready.begin(), ready.begin() + count);
+        ready.erase(ready.begin(), ready.begin() + count);
+    }
+    if (!missing.empty())
+        queueCondition.notify_one();
+
+    // upload a bounded number of tiles per frame, no stalls when panning fast
+    for (auto &loaded : uploads)
+    {
+        pending.erase(loaded.key);
+
+        if (loaded.image.data == nullptr)
+            continue;
+
+        Texture2D texture = LoadTextureFromImage(loaded.image);
+        UnloadImage(loaded.image);
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+        SetTextureWrap(texture, TEXTURE_WRAP_CLAMP);
+
+        if (loaded.key == previewKey)
+        {
+            preview = texture;
+            continue;
+        }
+
+        lruOrder.push_front(loaded.key);
+        resident[loaded.key] = Tile{texture, lruOrder.begin()};
+        residentBytes += (size_t)texture.width * texture.height * 4;
+    }
+
+    evict(wanted);
+}
+
+void TileStreamer::draw(RenderQueue &queue, Rectangle visibleArea) const
+{
+    if (preview.id != 0)
+        queue.drawTexture(RenderLayer::Background, preview, {0, 0, (float)preview.width, (float)preview.height}, {0, 0, mapSize.x, mapSize.y}, {0, 0}, WHITE, 0);
+
+    int x0, y0, x1, y1;
+    tileRange(visibleArea, x0, y0, x1, y1);
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            auto it = resident.find(makeKey(x, y));
+            if (it == resident.end())
+                continue; // still streaming, preview shows through
+
+            const Texture2D &texture = it->second.texture;
+            queue.drawTexture(RenderLayer::Background, texture, {0, 0, (float)texture.width, (float)texture.height}, tileBounds(x, y), {0, 0}, WHITE, 1);
+        }
+    }
+}
+
+void TileStreamer::evict(const std::unordered_set<TileKey> &keep)
+{
+    // least recently used first; tiles needed this frame are never evicted
+    auto it = lruOrder.end();
+    while (residentBytes > budgetBytes && it != lruOrder.begin())
+    {
+        --it;
+        if (keep.find(*it) != keep.end())
+            continue;
+
+        auto tile = resident.find(*it);
+        residentBytes -= (size_t)tile->second.texture.width * tile->second.texture.height * 4;
+        UnloadTexture(tile->second.texture);
+        resident.erase(tile);
+        it = lruOrder.erase(it);
+    }
+}
+
+void TileStreamer::workerMain()
+{
+    while (true)
+    {
+        TileKey key;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]()
+                                { return stopWorker || !requests.empty(); });
+            if (stopWorker)
+                break;
+
+            key = requests.front();
+            requests.pop_front();
+        }
+
+        // decoding happens outside the lock
+        Image image = loadTileImage(key);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        ready.push_back(LoadedImage{key, image});
+    }
+}
+
+Image TileStreamer::loadTileImage(TileKey key)
+{
+    const std::string fileName = tileFileName(key);
+    const std::string shippedPath = tileDirectory + "/" + fileName;
+    if (FileExists(shippedPath.c_str()))
+        return LoadImage(shippedPath.c_str());
+
+    // no pre-cut tiles: cut all of them from the source into the cache once, then let the full image go again
+    if (!tilesCut)
+    {
+        tilesCut = true;
+        if (!cacheIsCurrent())
+            cutTiles();
+    }
+    const std::string cachedPath = cacheDirectory + "/" + fileName;
+    if (FileExists(cachedPath.c_str()))
+        return LoadImage(cachedPath.c_str());
+
+    // the cache is not writable: decode the source for this one tile
+    Image source = LoadImage(sourcePath.c_str());
+    if (source.data == nullptr)
+        return Image{};
+    Image image = cutTile(source, key);
+    UnloadImage(source);
+    return image;
+}
+
+Image TileStreamer::cutTile(const Image &source, TileKey key) const
+{
+    if (key == previewKey)
+    {
+        Image image = ImageCopy(source);
+        ImageResize(&image, previewSize, previewSize);
+        return image;
+    }
+
+    const float scaleX = (float)source.width / mapSize.x;
+    const float scaleY = (float)source.height / mapSize.y;
+    Rectangle bounds = tileBounds(keyX(key), keyY(key));
+
+    return ImageFromImage(source, {bounds.x * scaleX, bounds.y * scaleY, bounds.width * scaleX, bounds.height * scaleY});
+}
+
+std::string TileStreamer::tileFileName(TileKey key)
+{
+    if (key == previewKey)
+        return "preview.png";
+    return "tile_" + std::to_string(keyX(key)) + "_" + std::to_string(keyY(key)) + ".png";
+}
+
+bool TileStreamer::cacheIsCurrent() const
+{
+    // preview.png is written last, it marks a complete set
+    std::error_code error;
+    const auto cut = std::filesystem::last_write_time(cacheDirectory + "/" + tileFileName(previewKey), error);
+    if (error)
+        return false;
+    const auto source = std::filesystem::last_write_time(sourcePath, error);
+    return !error && cut >= source;
+}
+
+void TileStreamer::cutTiles()
+{
+    Image source = LoadImage(sourcePath.c_str());
+    if (source.data == nullptr)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+
+    // one tile at a time; stops at the first file that cannot be written
+    auto cut = [&](TileKey key)
+    {
+        Image image = cutTile(source, key);
+        const bool written = ExportImage(image, (cacheDirectory + "/" + tileFileName(key)).c_str());
+        UnloadImage(image);
+        return written;
+    };
+
+    bool written = true;
+    for (int y = 0; y < rows && written && !stopWorker; y++)
+        for (int x = 0; x < cols && written && !stopWorker; x++)
+            written = cut(makeKey(x, y));
+    if (written && !stopWorker)
+        cut(previewKey);
+
+    UnloadImage(source);
+}
+
+Rectangle TileStreamer::tileBounds(int x, int y) const
+{
+    const float left = x * tileSize;
+    const float top = y * tileSize;
+    return {left, top, std::min(tileSize, mapSize.x - left), std::min(tileSize, mapSize.y - top)};
+}
+
+void TileStreamer::tileRange(Rectangle area, int &x0, int &y0, int &x1, int &y1) const
+{
+    x0 = std::clamp((int)std::floor(area.x / tileSize), 0, cols - 1);
+    y0 = std::clamp((int)std::floor(area.y / tileSize), 0, rows - 1);
+    x1 = std::clamp((int)std::floor((area.x + area.width) / tileSize), 0, cols - 1);
+    y1 = std::clamp((int)std::floor((area.y + area.height) / tileSize), 0, rows - 1);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <raylib.h>
+
+#include "RenderQueue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Streams the battlefield background as tiles.
+// Images are decoded/cropped on a worker thread, the main thread only uploads a few
+// finished tiles per frame and evicts the least recently used ones above the texture budget.
+// Tiles live in view space: the background looks the same for both players.
+class TileStreamer
+{
+public:
+    TileStreamer() = default;
+    ~TileStreamer();
+
+    TileStreamer(const TileStreamer &) = delete;
+    TileStreamer &operator=(const TileStreamer &) = delete;
+
+    // tileDirectory may contain pre-cut tiles named tile_<x>_<y>.png (and preview.png), it is only read.
+    // Otherwise the tiles are cut from sourcePath once into a subdirectory of the writable cacheDirectory
+    // per tile size, and cut again when the source is newer than them.
+    void init(const std::string &sourcePath, const std::string &tileDirectory, const std::string &cacheDirectory, Vector2 mapSize, float tileSize, size_t budgetBytes);
+    void shutdown();
+
+    void update(Rectangle visibleArea); // main thread: request, upload and evict tiles
+    void draw(RenderQueue &queue, Rectangle visibleArea) const;
+
+    size_t getResidentTiles() const { return resident.size(); }
+    size_t getResidentBytes() const { return residentBytes; }
+    size_t getPendingTiles() const { return pending.size(); }
+
+private:
+    using TileKey = uint32_t; // [ 16 bits x ][ 16 bits y ]
+    static constexpr TileKey previewKey = 0xFFFFFFFF;
+
+    static TileKey makeKey(int x, int y) { return ((TileKey)x << 16) | (TileKey)y; }
+    static int keyX(TileKey key) { return (int)(key >> 16); }
+    static int keyY(TileKey key) { return (int)(key & 0xFFFF); }
+
+    struct Tile
+    {
+        Texture2D texture;
+        std::list<TileKey>::iterator lru;
+    };
+
+    struct LoadedImage
+    {
+        TileKey key;
+        Image image;
+    };
+
+    void workerMain();
+    Image loadTileImage(TileKey key);
+    Image cutTile(const Image &source, TileKey key) const;
+    static std::string tileFileName(TileKey key);
+    bool cacheIsCurrent() const; // the cached tiles were cut from the current source
+    void cutTiles();             // writes tile_<x>_<y>.png and, once all of them are there, preview.png into the cache
+    Rectangle tileBounds(int x, int y) const;
+    void tileRange(Rectangle area, int &x0, int &y0, int &x1, int &y1) const;
+    void evict(const std::unordered_set<TileKey> &keep);
+
+    std::string sourcePath;
+    std::string tileDirectory;
+    std::string cacheDirectory;
+    Vector2 mapSize{0.f, 0.f};
+    float tileSize = 256.f;
+    int cols = 0;
+    int rows = 0;
+
+    size_t budgetBytes = 0;
+    const int maxUploadsPerFrame = 2; // texture uploads are the only main thread cost
+    const int prefetchRing = 1;       // tiles around the view requested ahead of panning
+    const int previewSize = 128;      // low-res full map drawn under missing tiles
+
+    // main thread
+    std::unordered_map<TileKey, Tile> resident;
+    std::list<TileKey> lruOrder; // front = most recently used
+    std::unordered_set<TileKey> pending;
+    size_t residentBytes = 0;
+    Texture2D preview{};
+
+    // worker thread
+    bool tilesCut = false; // the source is decoded only while tiles are cut from it, never kept
+
+    std::thread worker;
+    std::atomic<bool> stopWorker{false};
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<TileKey> requests;
+    std::vector<LoadedImage> ready;
+};
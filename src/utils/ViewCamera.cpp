@@ -0,0 +1,105 @@
+#include "ViewCamera.hpp"
+
+#include <algorithm>
+
+#include "Math.hpp"
+
+void ViewCamera::reset(Vector2 viewportSize)
+{
+    viewport = viewportSize;
+
+    camera.offset = {viewport.x / 2.f, viewport.y / 2.f};
+    camera.target = {worldWidth / 2.f, worldHeight / 2.f};
+    camera.rotation = 0.f;
+    camera.zoom = std::max(minZoom(), 1.f);
+
+    clampToWorld();
+}
+
+void ViewCamera::update(float dt, const InputState &input)
+{
+    if (input.keyPressed(KEY_HOME))
+    {
+        reset(viewport);
+        return;
+    }
+
+    // keyboard pan, same speed on screen regardless of zoom
+    Vector2 pan = {0.f, 0.f};
+    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
+        pan.x -= 1.f;
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
+        pan.x += 1.f;
+    if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W))
+        pan.y -= 1.f;
+    if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S))
+        pan.y += 1.f;
+
+    camera.target += Vector2Scale(pan, panSpeed * dt / camera.zoom);
+
+    // drag pan
+    if (input.mouseRightDown)
+    {
+        camera.target -= Vector2Scale(input.mouseDelta, 1.f / camera.zoom);
+    }
+
+    // zoom towards the mouse cursor
+    if (input.mouseWheel != 0.f)
+    {
+        Vector2 before = GetScreenToWorld2D(input.mousePos, camera);
+        camera.zoom = std::clamp(camera.zoom * (1.f + input.mouseWheel * zoomStep), minZoom(), maxZoom);
+        Vector2 after = GetScreenToWorld2D(input.mousePos, camera);
+        camera.target += before - after;
+    }
+
+    clampToWorld();
+}
+
+void ViewCamera::begin(float renderScale) const
+{
+    Camera2D scaled = camera;
+    scaled.offset = Vector2Scale(camera.offset, renderScale);
+    scaled.zoom = camera.zoom * renderScale;
+    BeginMode2D(scaled);
+}
+
+Vector2 ViewCamera::screenToWorld(Vector2 screenPos, bool inverted) const
+{
+    return ViewToWorld(GetScreenToWorld2D(screenPos, camera), inverted);
+}
+
+Rectangle ViewCamera::visibleViewBounds() const
+{
+    Vector2 topLeft = GetScreenToWorld2D({0.f, 0.f}, camera);
+    return {topLeft.x, topLeft.y, viewport.x / camera.zoom, viewport.y / camera.zoom};
+}
+
+Rectangle ViewCamera::visibleWorldBounds(bool inverted) const
+{
+    return ViewToWorld(visibleViewBounds(), inverted);
+}
+
+void ViewCamera::clampToWorld()
+{
+    // keep the view inside the battlefield; center it if the battlefield is smaller than the view
+    const float halfW = viewport.x / (2.f * camera.zoom);
+    const float halfH = viewport.y / (2.f * camera.zoom);
+
+    if (worldWidth > 2.f * halfW)
+        camera.target.x = std::clamp(camera.target.x, halfW, worldWidth - halfW);
+    else
+        camera.target.x = worldWidth / 2.f;
+
+    if (worldHeight > 2.f * halfH)
+        camera.target.y = std::clamp(camera.target.y, halfH, worldHeight - halfH);
+    else
+        camera.target.y = worldHeight / 2.f;
+}
+
+float ViewCamera::minZoom() const
+{
+    // out to twice the battlefield: a zoomed out overview is where culling and tile streaming pay off
+    if (viewport.x <= 0.f || viewport.y <= 0.f)
+        return 1.f;
+    return std::min(viewport.x / worldWidth, viewport.y / worldHeight) * minZoomOfFit;
+}
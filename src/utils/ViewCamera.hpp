@@ -0,0 +1,35 @@
+#pragma once
+#include <raylib.h>
+
+#include "ViewTransform.hpp"
+#include "InputState.hpp"
+
+// 2D camera with pan and zoom on top of the (possibly inverted) view space
+class ViewCamera
+{
+public:
+    void reset(Vector2 viewportSize);
+    void update(float dt, const InputState &input); // arrows/WASD or right mouse drag to pan, wheel to zoom, HOME to reset
+
+    void begin() const { BeginMode2D(camera); }
+    void begin(float renderScale) const; // for a scene rendered at a fraction of the window resolution
+    void end() const { EndMode2D(); }
+
+    Vector2 screenToWorld(Vector2 screenPos, bool inverted) const;
+    Rectangle visibleViewBounds() const;               // part of the view space currently on screen
+    Rectangle visibleWorldBounds(bool inverted) const; // same in world coordinates
+
+    float getZoom() const { return camera.zoom; }
+
+private:
+    void clampToWorld();
+    float minZoom() const;
+
+    Camera2D camera{};
+    Vector2 viewport{0.f, 0.f};
+
+    const float maxZoom = 3.f;
+    const float minZoomOfFit = 0.5f; // fraction of the zoom that fits the whole battlefield
+    const float panSpeed = 600.f; // screen pixels per second
+    const float zoomStep = 0.1f;  // per wheel notch
+};
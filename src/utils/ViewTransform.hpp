@@ -1,37 +1,49 @@
 #pragma once
 #include <raylib.h>
 
+#include "RenderQueue.hpp"
+
+// size of the battlefield in world units, independent of the window size
+constexpr float worldWidth = 800.f;
+constexpr float worldHeight = 800.f;
+
+// world -> view space; the view space is what the camera (pan/zoom) looks at
 inline Vector2 WorldToView(Vector2 worldPos, bool inverted)
 {
     if(!inverted)
         return worldPos;
 
-    float worldHeight = GetScreenHeight(); // 800.f 
-    float worldWidth = GetScreenWidth(); // 800.f
-
     return { worldWidth - worldPos.x, worldHeight - worldPos.y }; // invert y/x axis for player 
 }
 
 // for revieving input 
-inline Vector2 ViewToWorld(Vector2 screenPos, bool inverted)
+inline Vector2 ViewToWorld(Vector2 viewPos, bool inverted)
 {
     if(!inverted)
-        return screenPos;
+        return viewPos;
 
-    float worldHeight = GetScreenHeight(); // 800.f 
-    float worldWidth = GetScreenWidth(); // 800.f
+    return { worldWidth - viewPos.x, worldHeight - viewPos.y }; // invert y/x axis for player 
+}
+
+// same as above for a whole rectangle
+inline Rectangle ViewToWorld(Rectangle viewRect, bool inverted)
+{
+    if(!inverted)
+        return viewRect;
 
-    return { worldWidth - screenPos.x, worldHeight - screenPos.y }; // invert y/x axis for player 
+    return { worldWidth - viewRect.x - viewRect.width, worldHeight - viewRect.y - viewRect.height, viewRect.width, viewRect.height };
 }
 
 
-// for inverse rendering 
+// for inverse rendering; recorded into the render queue
 inline void DrawEntityTexture(
+    RenderQueue &queue,
     Texture2D tex,
     Vector2 pos,
     Vector2 size,
     bool inverted,
-    float scale
+    float scale,
+    RenderLayer layer = RenderLayer::Units
 ) {
 
     Rectangle src = {
@@ -60,5 +72,5 @@ inline void DrawEntityTexture(
 
     Vector2 origin = { scaledSize.x / 2, scaledSize.y / 2 };
 
-    DrawTexturePro(tex, src, dst, origin, 0.0f, WHITE);
+    queue.drawTexture(layer, tex, src, dst, origin, WHITE);
 }
@@ -0,0 +1,16 @@
+#include "VoiceAllocator.hpp"
+
+void VoiceAllocator::init(const std::vector<int> &voicesPerSound, int maxActiveVoices)
+{
+    pools.clear();
+    for (int voices : voicesPerSound)
+        pools.emplace_back((size_t)(voices > 0 ? voices : 0));
+    maxActive = maxActiveVoices;
+}
+
+void VoiceAllocator::start(size_t sound, size_t voice, int priority, double now)
+{
+    State &state = pools[sound][voice];
+    state.startTime = now;
+    state.priority = priority;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Voice allocation of the AudioManager, without raylib: a pool of voices per sound and a global budget
+// of voices playing at once. A sound takes a free voice of its pool, or restarts its oldest one; when the
+// budget is used up it steals the lowest priority, oldest playing voice of any sound, unless that one is
+// more important than itself. Whether a voice still plays is asked through a callback.
+class VoiceAllocator
+{
+public:
+    struct Choice
+    {
+        bool found = false;  // false: everything is busy with more important sounds
+        size_t voice = 0;    // in the pool of the requested sound
+        bool steal = false;  // stop the victim first
+        size_t victimSound = 0;
+        size_t victimVoice = 0;
+    };
+
+    void init(const std::vector<int> &voicesPerSound, int maxActiveVoices);
+
+    // isPlaying(sound, voice) -> bool
+    template <typename IsPlaying>
+    Choice acquire(size_t sound, int priority, IsPlaying &&isPlaying) const;
+
+    void start(size_t sound, size_t voice, int priority, double now);
+    void stop(size_t sound, size_t voice) { pools[sound][voice].startTime = -1.0; }
+
+    int getMaxActiveVoices() const { return maxActive; }
+
+private:
+    struct State
+    {
+        double startTime = -1.0; // < 0: never started or stolen
+        int priority = 0;
+    };
+
+    std::vector<std::vector<State>> pools;
+    int maxActive = 0;
+};
+
+template <typename IsPlaying>
+VoiceAllocator::Choice VoiceAllocator::acquire(size_t sound, int priority, IsPlaying &&isPlaying) const
+{
+    Choice choice;
+    if (sound >= pools.size() || pools[sound].empty())
+        return choice;
+
+    auto active = [&](size_t s, size_t v)
+    { return pools[s][v].startTime >= 0.0 && isPlaying(s, v); };
+
+    // free voice of this sound, otherwise the oldest one of its own pool
+    const std::vector<State> &own = pools[sound];
+    bool ownIsFree = false;
+    for (size_t v = 0; v < own.size(); v++)
+    {
+        if (!active(sound, v))
+        {
+            choice.voice = v;
+            ownIsFree = true;
+            break;
+        }
+        if (own[v].startTime < own[choice.voice].startTime)
+            choice.voice = v;
+    }
+    choice.found = true;
+    if (!ownIsFree)
+        return choice; // restarting one of our own voices keeps the count
+
+    // global voice budget: steal the lowest priority, oldest voice if the budget is used up
+    int playing = 0;
+    bool haveVictim = false;
+    for (size_t s = 0; s < pools.size(); s++)
+    {
+        for (size_t v = 0; v < pools[s].size(); v++)
+        {
+            if (!active(s, v))
+                continue;
+            playing++;
+
+            const State &state = pools[s][v];
+            const State *victim = haveVictim ? &pools[choice.victimSound][choice.victimVoice] : nullptr;
+            if (!victim || state.priority < victim->priority || (state.priority == victim->priority && state.startTime < victim->startTime))
+            {
+                choice.victimSound = s;
+                choice.victimVoice = v;
+                haveVictim = true;
+            }
+        }
+    }
+
+    if (playing < maxActive || !haveVictim)
+        return choice;
+
+    if (pools[choice.victimSound][choice.victimVoice].priority > priority)
+    {
+        choice.found = false;
+        return choice;
+    }
+    choice.steal = true;
+    return choice;
+}
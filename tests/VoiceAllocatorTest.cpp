@@ -0,0 +1,119 @@
+// Voice stealing of the AudioManager's allocator: a full budget gives way to more important sounds
+// and never to less important ones.
+
+#include <cstdio>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "utils/VoiceAllocator.hpp"
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    enum Sound : size_t
+    {
+        Low,  // priority 0, 3 voices
+        Mid,  // priority 1, 3 voices
+        High, // priority 2, 1 voice
+    };
+    constexpr int priorities[] = {0, 1, 2};
+
+    struct Mixer
+    {
+        VoiceAllocator allocator;
+        std::set<std::pair<size_t, size_t>> playing;
+        double now = 0.0;
+
+        Mixer() { allocator.init({3, 3, 1}, 4); }
+
+        VoiceAllocator::Choice play(size_t sound)
+        {
+            const VoiceAllocator::Choice choice = allocator.acquire(sound, priorities[sound], [this](size_t s, size_t v)
+                                                                    { return playing.count({s, v}) != 0; });
+            if (!choice.found)
+                return choice;
+            if (choice.steal)
+            {
+                playing.erase({choice.victimSound, choice.victimVoice});
+                allocator.stop(choice.victimSound, choice.victimVoice);
+            }
+            playing.insert({sound, choice.voice});
+            allocator.start(sound, choice.voice, priorities[sound], now);
+            now += 1.0;
+            return choice;
+        }
+    };
+
+    void lowPriorityVoiceIsStolen()
+    {
+        Mixer mixer;
+        mixer.play(Low);
+        mixer.play(Low);
+        mixer.play(Low);
+        check(!mixer.play(Mid).steal, "a voice within the budget steals nothing");
+        check(mixer.playing.size() == 4, "budget of 4 used up");
+
+        const VoiceAllocator::Choice choice = mixer.play(High);
+        check(choice.found && choice.steal, "a more important sound steals when the budget is used up");
+        check(choice.victimSound == Low && choice.victimVoice == 0, "the victim is the oldest low priority voice");
+        check(mixer.playing.size() == 4, "stealing keeps the budget");
+        check(mixer.playing.count({High, 0}) == 1, "the important sound plays");
+    }
+
+    void moreImportantVoicesAreKept()
+    {
+        Mixer mixer;
+        mixer.play(Mid);
+        mixer.play(Mid);
+        mixer.play(Mid);
+        mixer.play(High);
+
+        const VoiceAllocator::Choice choice = mixer.play(Low);
+        check(!choice.found, "a less important sound does not play over a full budget");
+        check(mixer.playing.size() == 4 && mixer.playing.count({Low, 0}) == 0, "nothing was stopped for it");
+    }
+
+    void ownVoiceIsRestarted()
+    {
+        Mixer mixer;
+        mixer.play(High);
+        const VoiceAllocator::Choice choice = mixer.play(High);
+        check(choice.found && !choice.steal && choice.voice == 0, "a busy pool restarts its own oldest voice");
+    }
+
+    void finishedVoicesAreFree()
+    {
+        Mixer mixer;
+        mixer.play(Low);
+        mixer.play(Low);
+        mixer.play(Low);
+        mixer.play(Mid);
+        mixer.playing.erase({Low, 1}); // ran out
+
+        const VoiceAllocator::Choice choice = mixer.play(Mid);
+        check(choice.found && !choice.steal, "a voice that finished frees its slot in the budget");
+    }
+}
+
+int main()
+{
+    lowPriorityVoiceIsStolen();
+    moreImportantVoicesAreKept();
+    ownVoiceIsRestarted();
+    finishedVoicesAreFree();
+
+    if (failures == 0)
+        std::printf("VoiceAllocatorTest passed\n");
+    return failures == 0 ? 0 : 1;
+}